@@ -0,0 +1,83 @@
+#ifndef IEX_TOOLS_BOOK_HPP
+#define IEX_TOOLS_BOOK_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <iextoolslib/deep_messages.hpp>
+#include <iextoolslib/types.hpp>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace IEXTools {
+
+struct PriceLevel {
+  Price price;
+  Integer size;
+};
+
+struct BookSnapshot {
+  Timestamp timestamp;
+  std::vector<PriceLevel> bids;  // best first
+  std::vector<PriceLevel> asks;  // best first
+};
+
+/**
+ * Price-level book of a single symbol.
+ *
+ * Each side is a flat array sorted so that the best level is the last element: most updates touch the top of the book,
+ * which then only shifts a few elements. Updates of an event are buffered until the event completes and are applied
+ * together, so the book is never observed in transition.
+ */
+struct PriceLevelBook {
+  // Returns true when the update completed an event and the book changed
+  bool apply(const PriceLevelUpdateMessage& update);
+
+  [[nodiscard]] bool in_transition() const { return !pending.empty(); }
+  [[nodiscard]] Timestamp last_update() const { return timestamp; }
+
+  [[nodiscard]] std::size_t depth(Side side) const { return levels(side).size(); }
+  // i-th best level of a side, 0 being the top of the book
+  [[nodiscard]] const PriceLevel& level(Side side, std::size_t i) const {
+    const auto& l = levels(side);
+    return l[l.size() - 1 - i];
+  }
+
+  [[nodiscard]] BookSnapshot snapshot(std::size_t max_depth = std::numeric_limits<std::size_t>::max()) const;
+
+ private:
+  struct PendingUpdate {
+    Side side;
+    Price price;
+    Integer size;
+  };
+
+  [[nodiscard]] const std::vector<PriceLevel>& levels(Side side) const { return side == Buy ? bids : asks; }
+  void update(Side side, Price price, Integer size);
+
+  std::vector<PriceLevel> bids;  // ascending prices
+  std::vector<PriceLevel> asks;  // descending prices
+  std::vector<PendingUpdate> pending;
+  Timestamp timestamp = 0;
+};
+
+inline uint64_t symbol_key(const Symbol& symbol) {
+  uint64_t key;
+  std::memcpy(&key, symbol.data(), sizeof(key));
+  return key;
+}
+
+// Keeps a PriceLevelBook per symbol out of a stream of DEEP messages
+struct DeepBookBuilder {
+  // Returns the book of the symbol when the update completed an event on it, nullptr otherwise
+  PriceLevelBook* apply(const PriceLevelUpdateMessage& update);
+
+  [[nodiscard]] const PriceLevelBook* find(const Symbol& symbol) const;
+
+ private:
+  std::unordered_map<uint64_t, PriceLevelBook> books;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_BOOK_HPP
@@ -0,0 +1,36 @@
+#ifndef IEX_TOOLS_CACHE_HPP
+#define IEX_TOOLS_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <iextoolslib/columns.hpp>
+#include <string>
+
+namespace IEXTools {
+
+/**
+ * Directory of decoded captures, so repeated runs over the same capture skip the pcap-ng parsing.
+ *
+ * Entries are named after a key hashed from the size, modification time and sampled content of the capture, plus the
+ * version of the entry layout, so a changed capture or a new decoder never reads a stale entry. An entry holds every
+ * column of an unfiltered ColumnarCapture, each one aligned to a cache line, and is mapped read-only when loaded: the
+ * columns of the returned capture view the mapping instead of copying it.
+ */
+struct CaptureCache {
+  explicit CaptureCache(std::filesystem::path dir);
+
+  // The capture mapped from its entry, decoded and stored first when there is none
+  ColumnarCapture load(const std::string& file_path) const;
+
+  [[nodiscard]] static std::string key(const std::string& file_path);
+
+ private:
+  [[nodiscard]] static ColumnarCapture map(const std::filesystem::path& path);
+  static void store(const ColumnarCapture& capture, const std::filesystem::path& path);
+
+  const std::filesystem::path dir;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_CACHE_HPP
@@ -0,0 +1,41 @@
+#ifndef IEX_TOOLS_CHECKPOINT_HPP
+#define IEX_TOOLS_CHECKPOINT_HPP
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <iextoolslib/output.hpp>
+#include <iextoolslib/types.hpp>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace IEXTools {
+
+/**
+ * Progress of a decode, enough to resume it after a crash and produce the same output as an uninterrupted run.
+ *
+ * Everything decoded from the capture up to `offset` has been handed to the output files, which had the recorded
+ * sizes at that point. `state` holds the serialized per-symbol analytic state at `offset`.
+ */
+struct Checkpoint {
+  static inline const char* FILE_NAME = ".checkpoint";
+
+  off_t offset = 0;         // of the first block not yet processed
+  Long last_sequence = 0;   // sequence number of the last processed message
+  bool join_quotes = false;
+  Compression compression = Compression::None;
+  std::map<std::string, uintmax_t> files;  // symbol -> size of its output file
+  std::string state;
+
+  // Writes the checkpoint to `out_dir` atomically, a crash while saving leaves the previous one in place
+  void save(const std::filesystem::path& out_dir) const;
+
+  static std::optional<Checkpoint> load(const std::filesystem::path& out_dir);
+  static void remove(const std::filesystem::path& out_dir);
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_CHECKPOINT_HPP
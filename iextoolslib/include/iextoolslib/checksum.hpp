@@ -0,0 +1,47 @@
+#ifndef IEX_TOOLS_CHECKSUM_HPP
+#define IEX_TOOLS_CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iextoolslib/pcap_frames.hpp>
+#include <string>
+
+namespace IEXTools {
+
+// One's complement sum of `data` read as 16 bit words, folded to 16 bits. Words are summed in host order, which only
+// byte-swaps the result, so a checksummed header verifies when the sum is 0xffff either way. Uses AVX2 on x86 CPUs
+// having it
+uint16_t ones_complement_sum(const std::byte* data, std::size_t length, uint64_t initial = 0);
+
+/**
+ * Opt-in integrity check of the IPv4 header and UDP checksums of every packet.
+ *
+ * Packets failing either check are counted and appended to quarantine.pcapng in `out_dir` as they are found, instead
+ * of being decoded, so an interrupted run keeps them. A zero UDP checksum means the sender did not compute it, and is
+ * accepted.
+ */
+struct PacketVerifier {
+  explicit PacketVerifier(std::filesystem::path out_dir) : out_dir(std::move(out_dir)) {}
+
+  // Returns false when the packet must not be decoded
+  bool verify(const PcapFrame& frame, const EnhancedPacketBlock& packet);
+
+  // Reports the counts on stderr
+  void finish() const;
+
+  std::size_t verified = 0;
+  std::size_t bad_ip = 0;
+  std::size_t bad_udp = 0;
+
+ private:
+  void write_quarantined(const PcapFrame& frame);
+
+  const std::filesystem::path out_dir;
+  std::ofstream quarantine;  // opened at the first bad packet
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_CHECKSUM_HPP
@@ -0,0 +1,136 @@
+#ifndef IEX_TOOLS_COLUMNS_HPP
+#define IEX_TOOLS_COLUMNS_HPP
+
+#include <cstddef>
+#include <iextoolslib/pcap_frames.hpp>
+#include <iextoolslib/types.hpp>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace IEXTools {
+
+// Values of one field. Either owned, while decoding, or a view of memory kept alive elsewhere, such as a mapped cache
+template <typename T>
+struct Column {
+  void push_back(const T& value) { owned.push_back(value); }
+
+  void reserve(std::size_t n) { owned.reserve(n); }
+
+  // Appends `n` values to fill in through the returned pointer
+  T* grow(std::size_t n) {
+    owned.resize(owned.size() + n);
+    return owned.data() + owned.size() - n;
+  }
+
+  // Makes the column a read-only view of `size` values at `data`
+  void view(const T* data, std::size_t size) {
+    owned = {};
+    mapped = data;
+    mapped_size = size;
+  }
+
+  [[nodiscard]] const T* data() const { return mapped != nullptr ? mapped : owned.data(); }
+  [[nodiscard]] std::size_t size() const { return mapped != nullptr ? mapped_size : owned.size(); }
+  [[nodiscard]] bool empty() const { return size() == 0; }
+  const T& operator[](std::size_t i) const { return data()[i]; }
+  [[nodiscard]] const T& front() const { return data()[0]; }
+  [[nodiscard]] const T& back() const { return data()[size() - 1]; }
+  [[nodiscard]] const T* begin() const { return data(); }
+  [[nodiscard]] const T* end() const { return data() + size(); }
+
+ private:
+  std::vector<T> owned;
+  const T* mapped = nullptr;
+  std::size_t mapped_size = 0;
+};
+
+// Messages kept by ColumnarCapture::decode. Checked on the raw message bytes, before anything else is decoded
+struct ColumnFilter {
+  std::vector<Symbol> symbols;  // empty for every symbol
+  Timestamp begin = std::numeric_limits<Timestamp>::min();
+  Timestamp end = std::numeric_limits<Timestamp>::max();  // exclusive
+
+  [[nodiscard]] bool accepts(Timestamp timestamp, const Symbol& symbol) const;
+};
+
+struct TradeTable {
+  Column<Timestamp> timestamp;
+  Column<Symbol> symbol;
+  Column<Integer> size;
+  Column<double> price;
+  Column<Long> trade_id;
+  Column<Byte> flags;
+
+  [[nodiscard]] std::size_t rows() const { return timestamp.size(); }
+};
+
+struct QuoteTable {
+  Column<Timestamp> timestamp;
+  Column<Symbol> symbol;
+  Column<Integer> bid_size;
+  Column<double> bid_price;
+  Column<double> ask_price;
+  Column<Integer> ask_size;
+  Column<Byte> flags;
+
+  [[nodiscard]] std::size_t rows() const { return timestamp.size(); }
+};
+
+/**
+ * Trades, quotes and trade breaks of a TOPS capture decoded straight into columns, one array per field, for consumers
+ * that want arrays instead of per-symbol CSV files (the Python bindings hand these arrays out without copying them).
+ *
+ * `events` keeps the capture order across the tables: one PACKET entry per IEX-TP packet, whose send time is the next
+ * entry of `packets`, then the message type of every row in the order the rows were decoded. That is enough to feed
+ * the messages again in their original order, see TopsReader.
+ */
+struct ColumnarCapture {
+  static constexpr Byte PACKET = 0;
+
+  static ColumnarCapture decode(const std::string& file_path, const ColumnFilter& filter = {});
+
+  // Copy of the rows accepted by `filter`, as decode() with that filter would have returned them
+  [[nodiscard]] ColumnarCapture select(const ColumnFilter& filter) const;
+
+  TradeTable trades;
+  QuoteTable quotes;
+  TradeTable breaks;  // fields of the broken trades
+  Column<Byte> events;
+  Column<Timestamp> packets;
+
+  std::shared_ptr<const void> storage;  // keeps the memory of viewed columns alive
+};
+
+/**
+ * Decodes IEX-TP packets into a ColumnarCapture in batches.
+ *
+ * Trade reports and quote updates have fixed layouts, so instead of reading them field by field the decoder only
+ * collects the addresses of the messages of each type, then decodes whole batches into the columns at once, so the
+ * columns grow once per batch instead of once per value. Breaks are rare and decoded right away.
+ *
+ * Collected messages are decoded when their batch is full or on flush(), the packets must stay alive until then.
+ */
+struct ColumnDecoder {
+  ColumnDecoder(ColumnarCapture& capture, const ColumnFilter& filter = {});
+
+  void on_packet(const IexTpFrame& iex_tp);
+
+  // Decodes every collected message
+  void flush();
+
+ private:
+  void flush_trades();
+  void flush_quotes();
+
+  ColumnarCapture& capture;
+  const ColumnFilter& filter;
+  const bool filtering;
+  std::vector<const std::byte*> trades;  // message bodies waiting in the batch, after the type byte
+  std::vector<const std::byte*> quotes;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_COLUMNS_HPP
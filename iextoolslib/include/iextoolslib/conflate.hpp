@@ -0,0 +1,82 @@
+#ifndef IEX_TOOLS_CONFLATE_HPP
+#define IEX_TOOLS_CONFLATE_HPP
+
+#include <cstdint>
+#include <iextoolslib/timer_wheel.hpp>
+#include <iextoolslib/tops_messages.hpp>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace IEXTools {
+
+struct ConflationOptions {
+  Timestamp interval = 0;  // least exchange time between two quotes of a symbol, 0 for no limit
+  Price threshold = 0;     // least move of the bid or ask price, 0 for any change of the quote
+
+  [[nodiscard]] bool enabled() const { return interval > 0 || threshold > 0; }
+};
+
+/**
+ * Thins out the quote updates of every symbol for consumers that only need the current BBO.
+ *
+ * A quote is significant when a side appeared or disappeared, or when its bid or ask price moved by more than the
+ * threshold from the last quote emitted for the symbol. A significant quote is emitted right away unless the symbol
+ * already emitted one less than an interval ago; it then waits for the end of that interval, replaced by any later
+ * quote of the symbol, and the latest quote is emitted when a TimerWheel timer fires. Quotes that are not significant
+ * are held back the same way and emitted by finish(), so the final state of every symbol always reaches the output.
+ *
+ * Emitted quotes are `timestamp,bid_size,bid_price,ask_price,ask_size` lines for the `<SYMBOL>.quotes` file. State is
+ * O(1) per symbol and time only moves forward with the timestamps fed in.
+ */
+struct QuoteConflator {
+  using Lines = std::vector<std::pair<std::string, std::string>>;
+
+  static constexpr const char* SUFFIX = ".quotes";
+
+  explicit QuoteConflator(ConflationOptions options);
+
+  // Feeds a quote, appending to `lines` whatever became due by its timestamp
+  void on_quote(const QuoteUpdateMessage& quote, Lines& lines);
+
+  // Moves exchange time forward, appending the quotes whose interval ended to `lines`
+  void advance(Timestamp now, Lines& lines);
+
+  // Appends every quote still held back, at the end of the capture
+  void finish(Lines& lines);
+
+ private:
+  struct Quote {
+    Timestamp timestamp = 0;
+    Integer bid_size = 0;
+    Price bid_price = 0;
+    Price ask_price = 0;
+    Integer ask_size = 0;
+  };
+
+  struct State {
+    std::string file;
+    Quote last;                  // last emitted
+    Quote held;                  // latest quote not emitted yet
+    Timestamp next_allowed = 0;  // earliest time the next quote may be emitted
+    bool emitted = false;
+    bool holding = false;
+    bool held_significant = false;
+    bool scheduled = false;
+  };
+
+  [[nodiscard]] bool significant(const State& state, const Quote& quote) const;
+  // `at` is the exchange time of the emission, the quote itself keeps its timestamp
+  void emit(State& state, const Quote& quote, Timestamp at, Lines& lines);
+  void fire(uint32_t index, Lines& lines);
+
+  const ConflationOptions options;
+  std::vector<State> states;
+  std::unordered_map<uint64_t, uint32_t> lookup;  // symbol_key to states index
+  TimerWheel<uint32_t> timers;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_CONFLATE_HPP
@@ -0,0 +1,67 @@
+#ifndef IEX_TOOLS_DEEP_HPP
+#define IEX_TOOLS_DEEP_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <iextoolslib/book.hpp>
+#include <iextoolslib/checksum.hpp>
+#include <iextoolslib/output.hpp>
+#include <iextoolslib/pcap.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Price-level books of one DEEP stream.
+ *
+ * Every time an event completes on a symbol a snapshot of its top `depth` levels is appended to `<SYMBOL>.book.csv`:
+ * timestamp, then price,size for each bid level and each ask level, best first. Missing levels are left empty.
+ */
+struct DeepSnapshots {
+  explicit DeepSnapshots(std::size_t depth) : depth(depth) {}
+
+  void on_packet(const IexTpFrame& iex_tp);
+
+  // Appends the snapshot files to `writer`
+  void write(OutputWriter& writer) const;
+
+  [[nodiscard]] const DeepBookBuilder& books() const { return builder; }
+
+ private:
+  struct SymbolOutput {
+    std::string name;
+    std::string lines;
+  };
+
+  void format_snapshot(const PriceLevelBook& book, std::string& out) const;
+
+  DeepBookBuilder builder;
+  std::unordered_map<uint64_t, SymbolOutput> data;
+  const std::size_t depth;
+};
+
+// Builds the price-level books of a DEEP capture, see DeepSnapshots
+struct DeepReader {
+  DeepReader(const std::string& file_path, const std::string& out_dir, std::size_t depth, OutputOptions output = {},
+             bool verify_checksums = false);
+
+  void parse_data();
+
+  [[nodiscard]] const DeepBookBuilder& books() const { return snapshots.books(); }
+
+ private:
+  PcapReader pcap;
+  DeepSnapshots snapshots;
+  std::filesystem::path out_dir;
+  const OutputOptions output;
+  std::optional<PacketVerifier> verifier;
+
+  void dump_files() const;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_DEEP_HPP
@@ -0,0 +1,34 @@
+#ifndef IEX_TOOLS_DEEP_MESSAGES_HPP
+#define IEX_TOOLS_DEEP_MESSAGES_HPP
+
+#include <iextoolslib/types.hpp>
+#include <memory>
+#include <string>
+
+namespace IEXTools {
+
+struct PriceLevelUpdateMessage {
+  // event flags, when not set the book is in transition and more updates of the same event follow
+  static const Byte EVENT_PROCESSING_COMPLETE = 0x01;
+
+  PriceLevelUpdateMessage(Side side, Byte event_flags, Timestamp timestamp, Symbol symbol, Integer size, Price price);
+
+  const Side side;
+  const Byte event_flags;
+  const Timestamp timestamp;
+  const Symbol symbol;
+  const Integer size;  // aggregate size at the price level, 0 when the level is removed
+  const Price price;
+
+  [[nodiscard]] bool event_complete() const { return (event_flags & EVENT_PROCESSING_COMPLETE) != 0; }
+
+  // `it` points right after the message type, which tells the side of the update
+  static PriceLevelUpdateMessage read_from_block(pcap_cit_t it, Byte message_type);
+  static std::unique_ptr<PriceLevelUpdateMessage> from_raw_message(pcap_cit_t it, Byte message_type);
+
+  [[nodiscard]] std::string to_string() const;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_DEEP_MESSAGES_HPP
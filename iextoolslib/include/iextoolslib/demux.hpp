@@ -0,0 +1,105 @@
+#ifndef IEX_TOOLS_DEMUX_HPP
+#define IEX_TOOLS_DEMUX_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <iextoolslib/deep.hpp>
+#include <iextoolslib/spsc_ring.hpp>
+#include <iextoolslib/tops.hpp>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Sequence numbers of one IEX-TP stream, so every message is decoded once and in order.
+ *
+ * A packet overlapping messages already seen, such as a partial retransmission, only keeps the ones that are new.
+ * Packets past a gap are copied and held until late packets fill it, then released in sequence order. Once more than
+ * WINDOW packets are held the gap is declared lost and decoding moves on; its messages are dropped if they still come.
+ */
+struct SequenceTracker {
+  static constexpr std::size_t WINDOW = 1024;  // packets held behind a gap
+
+  // Fills `parts` with the packets, or pieces of them, whose messages are next in sequence. They stay valid until the
+  // next call. Returns false when there are none
+  bool accept(const IexTpFrame& iex_tp, std::vector<IexTpFrame>& parts);
+
+  // Declares the remaining gaps lost and fills `parts` with every held packet, at the end of the stream
+  void finish(std::vector<IexTpFrame>& parts);
+
+  Long next = 0;  // sequence number of the next message to release, 0 before the first packet
+  uint64_t gaps = 0;       // gaps declared lost
+  uint64_t missing = 0;    // messages of those gaps
+  uint64_t recovered = 0;  // messages that came after later ones and were put back in order
+  uint64_t late = 0;       // messages of a lost gap that came after all, dropped
+  uint64_t duplicates = 0;
+
+ private:
+  void release(std::vector<IexTpFrame>& parts);
+  void declare_lost(Long end);
+
+  std::map<Long, std::vector<std::byte>> held;  // IEX-TP segments past a gap, by first sequence number
+  std::vector<std::vector<std::byte>> released;  // segments of the parts handed out by the last call
+  std::map<Long, Long> lost;                     // first and end sequence numbers of the lost gaps
+};
+
+/**
+ * Splits a capture into its IEX-TP streams, keyed by (protocol, channel, session).
+ *
+ * Each stream is decoded on its own thread, fed through an SPSC ring by the thread reading the capture, with its own
+ * sequence tracking and output directory: `tops-<channel>-<session>` or `deep-<channel>-<session>` in OUT_DIR. TOPS
+ * streams produce the usual trade files, DEEP streams the book snapshots of DeepSnapshots. Packets of other protocols
+ * are counted and skipped.
+ */
+struct StreamDemux {
+  StreamDemux(const std::string& file_path, std::filesystem::path out_dir, TopsOptions options);
+
+  // Decodes the whole capture, then reports every stream on stderr
+  void run();
+
+ private:
+  using Key = std::tuple<Short, Integer, Integer>;  // protocol, channel, session
+
+  // IEX-TP segments copied out of the capture, header included
+  struct Batch {
+    std::vector<std::byte> bytes;
+    std::vector<std::size_t> offsets;
+  };
+
+  struct Stream {
+    Stream(Key key, std::size_t ring_capacity) : key(key), ring(ring_capacity) {}
+
+    const Key key;
+    SpscRing<Batch> ring;
+    Batch pending;  // owned by the reading thread
+    std::thread worker;
+
+    // owned by the worker
+    SequenceTracker sequence;
+    uint64_t packets = 0;
+    uint64_t messages = 0;
+    std::size_t files = 0;  // written, reported once every worker is done
+  };
+
+  Stream& stream(const IexTpFrame& iex_tp);
+  void push(Stream& stream);
+  void decode_tops(Stream& stream);
+  void decode_deep(Stream& stream);
+  [[nodiscard]] std::filesystem::path stream_dir(const Key& key) const;
+
+  const std::string file_path;
+  const std::filesystem::path out_dir;
+  const TopsOptions options;
+  std::map<Key, std::unique_ptr<Stream>> streams;
+  std::map<Short, uint64_t> skipped;  // packets of unknown protocols
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_DEMUX_HPP
@@ -0,0 +1,84 @@
+#ifndef IEX_TOOLS_MEMORY_HPP
+#define IEX_TOOLS_MEMORY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+
+namespace IEXTools {
+
+/**
+ * Memory resource counting the bytes held by one subsystem, and the most it ever held.
+ *
+ * Allocations go to `upstream`. Storage that does not come from a resource, such as the file buffer of a reader or
+ * the lines kept as std::string, is charged and released by its owner instead. Safe to use from several threads.
+ */
+struct MemoryAccount : std::pmr::memory_resource {
+  explicit MemoryAccount(const char* name, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+      : name(name), upstream(upstream) {}
+
+  void charge(std::size_t bytes);
+  void release(std::size_t bytes);
+
+  [[nodiscard]] std::size_t used() const { return current.load(std::memory_order_relaxed); }
+  [[nodiscard]] std::size_t peak() const { return highest.load(std::memory_order_relaxed); }
+
+  const char* const name;
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource* const upstream;
+  std::atomic<std::size_t> current{0};
+  std::atomic<std::size_t> highest{0};
+};
+
+// Bytes charged to an account for as long as the hold lives, moving along with the storage it stands for
+struct MemoryHold {
+  MemoryHold() = default;
+  MemoryHold(MemoryAccount& account, std::size_t bytes) : account(&account), bytes(bytes) { account.charge(bytes); }
+  MemoryHold(MemoryHold&& other) noexcept : account(other.account), bytes(other.bytes) { other.bytes = 0; }
+  MemoryHold& operator=(MemoryHold&& other) noexcept;
+  ~MemoryHold() { reset(); }
+
+  // Charges `bytes` in place of what was held
+  void resize(std::size_t bytes);
+  void reset() { resize(0); }
+
+ private:
+  MemoryAccount* account = nullptr;
+  std::size_t bytes = 0;
+};
+
+// Accounts of the subsystems of a run
+struct Memory {
+  static inline MemoryAccount reader{"reader"};      // capture bytes loaded or read ahead
+  static inline MemoryAccount frames{"frames"};      // decoded pcap-ng blocks and the frame list
+  static inline MemoryAccount messages{"messages"};  // formatted lines kept until the output files are written
+  static inline MemoryAccount output{"output"};      // data appended to output files and not yet written
+
+  // Peak of every account and of the process resident set
+  static void report(std::ostream& os);
+};
+
+/**
+ * Shares of a memory limit given to the subsystems, which keep under them with smaller buffers and earlier flushes
+ * rather than by failing: the capture is read in chunks, lines are spilled to sorted runs and output is written
+ * sooner. The frames of a chunk take about as much as the chunk itself.
+ */
+struct MemoryLimits {
+  explicit MemoryLimits(std::size_t limit);
+
+  std::size_t read_chunk;  // bytes of capture read at once
+  std::size_t messages;    // see TopsOptions::memory_budget
+  std::size_t output;      // see OutputOptions::buffer_limit
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_MEMORY_HPP
@@ -0,0 +1,144 @@
+#ifndef IEX_TOOLS_OUTPUT_HPP
+#define IEX_TOOLS_OUTPUT_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace IEXTools {
+
+enum class Compression { None, Gzip, Zstd };
+
+// Flushes a file or directory to disk, exits on failure
+void sync_path(const std::filesystem::path& path);
+
+struct OutputOptions {
+  Compression compression = Compression::None;
+  std::optional<int> level;  // compression level, the codec default when unset
+  unsigned threads = 0;      // compression threads, 0 for one per core
+  unsigned max_open = 0;     // files kept open at once, 0 for half the descriptor limit
+  // bytes appended to all files and not written yet before appending waits for them to be written, 0 for 64 MiB.
+  // Smaller limits also shrink the per-file buffers and compression blocks
+  std::size_t buffer_limit = 0;
+};
+
+/**
+ * Writes the output files of a run.
+ *
+ * Appends to a file are kept in call order. Without compression, appended data is buffered per file and written
+ * with a single writev once the file has enough of it, or when the buffers of all files together grow too large.
+ * With compression enabled, appended data is staged per file and cut into large blocks that a pool of background
+ * threads compresses as independent gzip members (or zstd frames), so the caller never waits for the codec.
+ * Compressed blocks are appended to the file in order as soon as they are ready.
+ *
+ * Pending data is bounded by OutputOptions::buffer_limit and charged to Memory::output.
+ *
+ * Descriptors come from a pool of bounded size that closes the least recently written file when full, so runs
+ * with thousands of symbols stay under the descriptor limit. Safe to use from several threads as long as each file
+ * is only appended to by one of them.
+ */
+struct OutputWriter {
+  explicit OutputWriter(std::filesystem::path out_dir, OutputOptions options = {});
+  ~OutputWriter();
+
+  OutputWriter(const OutputWriter&) = delete;
+  OutputWriter& operator=(const OutputWriter&) = delete;
+
+  void append(const std::string& file_name, std::string_view data);
+
+  // Writes every buffer and hands every staged block over to the compression threads, used when output must show
+  // up promptly
+  void flush();
+
+  // Waits until everything appended so far is in the files and flushes the files to disk
+  void sync();
+
+  // Writes everything that is pending and stops the compression threads
+  void finish();
+
+  // Whether the codec was enabled at build time
+  static bool supports(Compression compression);
+  // Whether the codec takes `level`: 0 to 9 for gzip, the range of the zstd library for zstd
+  static bool supports(Compression compression, int level);
+
+  // Prints how many files were written and where
+  void report() const;
+
+  [[nodiscard]] std::size_t file_count() const;
+
+  // Path of the file once written, including the extension of the compression format
+  [[nodiscard]] std::filesystem::path path(const std::string& file_name) const;
+
+ private:
+  struct File {
+    std::filesystem::path path;
+    std::mutex mutex;
+    std::string staging;
+    std::vector<std::string> buffers;  // uncompressed data waiting to be written, in order
+    std::size_t buffered = 0;
+    int fd = -1;                       // guarded by pool_mutex, and by mutex while being written
+    bool unsynced = false;             // written since the last sync, guarded by pool_mutex
+    std::list<File*>::iterator lru;    // position in open_files while fd is open and not being written
+    uint64_t next_block = 0;                 // sequence number of the next submitted block
+    uint64_t next_write = 0;                 // sequence number of the next block to append to the file
+    std::map<uint64_t, std::string> ready;  // compressed blocks waiting for an earlier one
+  };
+
+  struct Job {
+    File* file;
+    uint64_t block;
+    std::string data;
+  };
+
+  File& file(const std::string& file_name);
+  void submit(File& file, std::string data);
+  void work();
+  void wait_idle();
+  [[nodiscard]] std::string compress(const std::string& data) const;
+  void buffer(File& file, std::string_view data);
+  void hold(std::size_t bytes);
+  void drop(std::size_t bytes);
+  void write_buffers(File& file);
+  void write(File& file, const std::vector<std::string>& chunks);
+  void close_all();
+
+  const std::filesystem::path out_dir;
+  const OutputOptions options;
+  const std::size_t total_buffer_size;
+  const std::size_t file_buffer_size;
+  const std::size_t block_size;
+
+  mutable std::mutex files_mutex;
+  std::unordered_map<std::string, std::unique_ptr<File>> files;
+  std::atomic<std::size_t> buffered{0};  // bytes appended to all files and not written yet
+
+  std::mutex pool_mutex;
+  std::list<File*> open_files;  // most recently written first, without the files being written
+  std::size_t open_count = 0;   // open descriptors, including those being written
+  std::size_t max_open;
+
+  std::mutex jobs_mutex;
+  std::condition_variable jobs_cv;
+  std::condition_variable idle_cv;
+  std::deque<Job> jobs;
+  std::size_t in_flight = 0;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_OUTPUT_HPP
@@ -4,9 +4,11 @@
 #include <cstddef>
 #include <iterator>
 #include <memory>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
+#include "memory.hpp"
 #include "pcap_frames.hpp"
 
 namespace IEXTools {
@@ -47,17 +49,29 @@ struct PcapReader {
     return Iterator(&(*i));
   }
 
+  // Decodes the pcap-ng block starting at `it` and leaves `it` pointing to the next block. The decoded block is
+  // allocated from `arena` and lives as long as it does
+  static PcapFrame read_frame(pcap_cit_t& it, unsigned frame_number, std::pmr::memory_resource* arena);
+
+  // Length of the complete blocks at the start of `data`, the rest being the beginning of a block not read yet
+  static std::size_t complete_blocks_size(const std::byte* data, std::size_t size);
+
  private:
   [[nodiscard]] static std::size_t get_file_size(const std::string& path);
   std::vector<std::byte> load_data();
   std::vector<PcapFrame> get_frames();
-  static std::unique_ptr<PcapBlock> get_block(int block_type, pcap_cit_t it_begin, pcap_cit_t it_end);
-  static std::unique_ptr<EnhancedPacketBlock> get_enhanced_packet_block(pcap_cit_t it_begin, pcap_cit_t it_end);
+  static PcapBlock* get_block(int block_type, pcap_cit_t it_begin, pcap_cit_t it_end,
+                              std::pmr::memory_resource* arena);
+  static EnhancedPacketBlock* get_enhanced_packet_block(pcap_cit_t it_begin, pcap_cit_t it_end,
+                                                        std::pmr::memory_resource* arena);
 
   const std::string file_path;
   const size_t file_size;
   const std::vector<std::byte> data;
+  std::pmr::monotonic_buffer_resource arena;  // frame blocks, released all at once with the reader
   std::vector<PcapFrame> frames;
+  MemoryHold data_memory;
+  MemoryHold frames_memory;
 };
 }  // namespace IEXTools
 
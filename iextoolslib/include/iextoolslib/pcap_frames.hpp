@@ -3,10 +3,15 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdlib>
+#include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
+#include "pcap_utils.hpp"
 #include "types.hpp"
 
 namespace IEXTools {
@@ -45,6 +50,8 @@ struct IPv4Frame {
 };
 
 struct UDPFrame {
+  static const int HEADER_LENGTH = 8;
+
   UDPFrame(uint16_t source_port, uint16_t destination_port, uint16_t length, uint16_t checksum);
   const uint16_t source_port;
   const uint16_t destination_port;
@@ -55,6 +62,8 @@ struct UDPFrame {
 };
 
 struct IexTpFrame {
+  static const int HEADER_LENGTH = 40;
+
   IexTpFrame(Byte version, Short message_protocol_id, Integer channel_id, Integer session_id, Short payload_length,
              Short message_count, Long stream_offset, Long first_message_sequence_number, Timestamp send_time,
              pcap_cit_t data_it);
@@ -71,18 +80,50 @@ struct IexTpFrame {
   const pcap_cit_t data_it;
 
   static IexTpFrame read_from_block(pcap_cit_t& it);
+
+  // Calls f(message_type, it) for every message of the payload, `it` pointing right after the message type. When `f`
+  // takes a third argument it receives the length of the message body that follows the type
+  template <typename F>
+  void for_each_message(F&& f) const {
+    unsigned total_length = 0;
+
+    if (payload_length > 0 && message_count > 0) {
+      for (int i = 0; i < message_count; ++i) {
+        auto it{data_it + total_length};
+        auto message_length = read_bytes<Short>(it);
+        total_length += message_length + sizeof(message_length);
+
+        if (total_length > payload_length) {
+          capture_error("message length past the IEX-TP payload");
+        }
+
+        auto message_type = read_bytes<Byte>(it);
+        if constexpr (std::is_invocable_v<F, Byte, pcap_cit_t, Short>) {
+          f(message_type, it, static_cast<Short>(message_length - sizeof(message_type)));
+        } else {
+          f(message_type, it);
+        }
+      }
+    }
+
+    if (total_length != payload_length) {
+      std::cerr << "total_length != iex.payload_length" << std::endl;
+      // std:exit(1);
+    }
+  }
 };
 
+// Blocks live in the reader's arena and are released in bulk, so they must not need a destructor
 struct PcapBlock {
   PcapBlock(pcap_cit_t begin, pcap_cit_t end);
 
-  virtual ~PcapBlock() = default;
-
   pcap_cit_t begin;
   pcap_cit_t end;
 };
 
 struct EnhancedPacketBlock : public PcapBlock {
+  static const int BLOCK_TYPE = 0x00000006;
+
   EnhancedPacketBlock(pcap_cit_t begin, pcap_cit_t end, uint32_t interface_id, double timestamp,
                       uint32_t captured_packet_length, uint32_t original_packet_length, EthernetFrame ethernet,
                       IPv4Frame ip, UDPFrame udp, IexTpFrame iex_tp);
@@ -97,6 +138,8 @@ struct EnhancedPacketBlock : public PcapBlock {
   const IexTpFrame iex_tp;
 };
 
+static_assert(std::is_trivially_destructible_v<EnhancedPacketBlock>);
+
 struct PcapFrame {
   static const int HEADER_BLOCK_TYPE = 0x0A0D0D0A;
   static const int INTERFACE_DESCRIPTION_BLOCK_TYPE = 0x00000001;
@@ -108,18 +151,23 @@ struct PcapFrame {
   static const int CUSTOM_BLOCK_COPIABLE_TYPE = 0x00000BAD;
   static const int CUSTOM_BLOCK_NON_COPIABLE_TYPE = 0x40000BAD;
 
-  PcapFrame(int type, unsigned frame_number, size_t frame_length, pcap_cit_t iterator,
-            std::unique_ptr<PcapBlock> block);
+  PcapFrame(int type, unsigned frame_number, size_t frame_length, pcap_cit_t iterator, PcapBlock* block);
+
+  // Block of the frame when it is of type `Block`, nullptr otherwise. Dispatches on the frame type, no RTTI involved
+  template <typename Block>
+  [[nodiscard]] const Block* block_as() const {
+    return type == Block::BLOCK_TYPE ? static_cast<const Block*>(block) : nullptr;
+  }
 
   const int type;
-  const std::string type_name;
+  const std::string_view type_name;
   const unsigned frame_number;
   const size_t frame_length;
   const pcap_cit_t iterator;
-  std::unique_ptr<PcapBlock> block;
+  PcapBlock* block;  // owned by the arena of the reader, nullptr for unsupported block types
 
  private:
-  static std::string get_frame_type_name(int frame_type);
+  static std::string_view get_frame_type_name(int frame_type);
 };
 
 }  // namespace IEXTools
@@ -1,9 +1,11 @@
 #ifndef __IEXTOOLSLIB_PCAP_UTILS_HPP__
 #define __IEXTOOLSLIB_PCAP_UTILS_HPP__
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <iextoolslib/types.hpp>
+#include <stdexcept>
 #include <string>
 
 namespace IEXTools {
@@ -34,6 +36,17 @@ std::string symbol_to_string(Symbol symbol);
 std::string mac_addr_formatter(std::array<std::byte, 6> addr);
 std::string ip_addr_formatter(uint32_t addr);
 double price_to_double(Price price);
+// Exact decimal representation of a fixed point price, without trailing zeros
+std::string price_to_string(Price price);
+
+struct CaptureError : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Reports a capture that cannot be read or decoded: prints `message` and ends the process, or throws CaptureError once
+// throw_capture_errors() was called, for hosts that must outlive a bad capture such as the Python module
+[[noreturn]] void capture_error(const std::string& message);
+void throw_capture_errors();
 
 }  // namespace IEXTools
 
@@ -0,0 +1,103 @@
+#ifndef IEX_TOOLS_PIPELINE_HPP
+#define IEX_TOOLS_PIPELINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <iextoolslib/checkpoint.hpp>
+#include <iextoolslib/conflate.hpp>
+#include <iextoolslib/memory.hpp>
+#include <iextoolslib/output.hpp>
+#include <iextoolslib/spsc_ring.hpp>
+#include <iextoolslib/summary.hpp>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Pipelined TOPS decoding: a reader, a decoder and a writer stage running on their own threads and connected by
+ * bounded SPSC rings, so disk reads, decoding and output writing overlap.
+ *
+ * The reader hands over chunks that always end on a pcap-ng block boundary, so the decoder never sees a partial block.
+ * Produces the same per-symbol csv files as the sequential TopsReader.
+ *
+ * In follow mode the capture is treated like `tail -f`: once the end of the file is reached the reader waits on
+ * inotify for the writer to append more data, a partially written block is kept until the rest of it shows up, and
+ * every decoded batch is appended to the output files right away.
+ *
+ * With checkpoints enabled the decoder marks a batch every `checkpoint_interval` seconds with the analytic state at
+ * its end. Once the writer has that batch in the output files it records a Checkpoint in `out_dir`, which a resumed
+ * run uses to truncate the files back to that point and restart decoding from the block that followed. Compressed
+ * files decompress to the same content as an uninterrupted run, but not to the same bytes: a checkpoint ends the
+ * pending compression block of every file, and checkpoints are timed by the wall clock.
+ */
+struct TopsPipeline {
+  struct Options {
+    std::size_t read_size = 8 << 20;          // bytes per pread, multiple of the page size
+    std::size_t ring_capacity = 4;            // chunks/batches in flight between two stages
+    std::size_t flush_threshold = 64 << 10;   // per-symbol bytes buffered before appending to its file
+    bool follow = false;                      // keep waiting for data appended to the capture
+    unsigned idle_timeout = 0;                // seconds without new data before following stops, 0 to never stop
+    OutputOptions output;
+    bool join_quotes = false;  // see QuoteJoin
+    unsigned checkpoint_interval = 0;  // seconds between checkpoints, 0 to disable them
+    bool resume = false;               // continue from the checkpoint in out_dir
+    bool summary = false;              // see DailySummary, not kept in checkpoints
+    bool verify_checksums = false;     // see PacketVerifier
+    ConflationOptions conflation;      // see QuoteConflator, not kept in checkpoints
+  };
+
+  TopsPipeline(std::string file_path, std::filesystem::path out_dir);
+  TopsPipeline(std::string file_path, std::filesystem::path out_dir, Options options);
+
+  void run();
+
+  // Makes a following pipeline drain what it has read and return, safe to call from a signal handler
+  static void request_stop() { stop_requested.store(true); }
+
+ private:
+  using Bytes = std::vector<std::byte>;
+
+  struct Chunk {
+    Bytes data;
+    off_t end_offset = 0;  // file offset right after the last block
+    MemoryHold memory;
+  };
+
+  struct Batch {
+    std::vector<std::pair<std::string, std::string>> lines;
+    off_t end_offset = 0;
+    Long last_sequence = 0;
+    std::optional<std::string> state;  // analytic state at end_offset, set when a checkpoint is due
+  };
+
+  void read_stage();
+  void decode_stage();
+  void output_stage();
+
+  void prepare_resume();
+  void save_checkpoint(const Batch& batch, const std::map<std::string, std::string>& buffers,
+                       const OutputWriter& writer) const;
+
+  [[nodiscard]] std::size_t wait_for_data(int fd, off_t offset, int watch_fd) const;
+
+  static inline std::atomic<bool> stop_requested{false};
+
+  const std::string file_path;
+  const std::filesystem::path out_dir;
+  const Options options;
+
+  std::optional<Checkpoint> resume_from;
+  std::optional<DailySummary> summary;  // filled by the decoder, written by the writer once decoding is over
+
+  SpscRing<Chunk> chunks;
+  SpscRing<Batch> batches;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_PIPELINE_HPP
@@ -0,0 +1,56 @@
+#ifndef IEX_TOOLS_REPLAY_HPP
+#define IEX_TOOLS_REPLAY_HPP
+
+#include <netinet/in.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iextoolslib/pcap.hpp>
+#include <string>
+
+namespace IEXTools {
+
+/**
+ * Sends the UDP payloads (IEX-TP segments) of a capture to a destination socket.
+ *
+ * Packets are scheduled from their capture timestamps divided by `speed`, or sent back to back when `speed` is 0.
+ * Waiting uses clock_nanosleep until shortly before a packet is due and then spins, or spins the whole time with
+ * `busy_poll`. Every packet already due goes out in a single sendmmsg call.
+ */
+struct UdpReplayer {
+  struct Options {
+    double speed = 1.0;      // 1 for the original pacing, 0 for as fast as possible
+    bool busy_poll = false;  // spin instead of sleeping, more accurate at the cost of a core
+    unsigned batch = 64;     // maximum packets per sendmmsg
+  };
+
+  struct Report {
+    std::size_t packets = 0;
+    std::size_t bytes = 0;
+    double seconds = 0;
+    // delay between the time a packet was due and the time it was handed to the kernel, paced modes only
+    double mean_error_ns = 0;
+    int64_t p50_error_ns = 0;
+    int64_t p99_error_ns = 0;
+    int64_t max_error_ns = 0;
+  };
+
+  UdpReplayer(const std::string& host, uint16_t port, Options options);
+  ~UdpReplayer();
+
+  UdpReplayer(const UdpReplayer&) = delete;
+  UdpReplayer& operator=(const UdpReplayer&) = delete;
+
+  Report replay(PcapReader& pcap);
+
+ private:
+  const Options options;
+  sockaddr_in destination{};
+  int fd = -1;
+};
+
+}  // namespace IEXTools
+
+std::ostream& operator<<(std::ostream& os, const IEXTools::UdpReplayer::Report& obj);
+
+#endif  // IEX_TOOLS_REPLAY_HPP
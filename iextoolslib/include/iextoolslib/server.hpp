@@ -0,0 +1,113 @@
+#ifndef IEX_TOOLS_SERVER_HPP
+#define IEX_TOOLS_SERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iextoolslib/columns.hpp>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Answers queries over a decoded capture kept in memory.
+ *
+ * Rows of every symbol are indexed by timestamp, so a time range is two binary searches away. Requests are one line,
+ * times being nanoseconds since the epoch or HH:MM[:SS[.fff]] in the local time zone of the capture day:
+ *
+ *   symbols                               symbol,trades,quotes
+ *   trades SYMBOL [FROM [TO]]             timestamp,size,price,trade_id
+ *   quotes SYMBOL [FROM [TO]]             timestamp,bid_size,bid_price,ask_price,ask_size
+ *   stats SYMBOL [FROM [TO]]              trades,volume,vwap,high,low,first_time,last_time
+ *   top N [volume|trades|notional] [FROM [TO]]   symbol,value
+ *
+ * The answer starts with `OK <rows>` followed by that many lines, or is a single `ERR <reason>` line. Broken trades
+ * are left out. answer() only reads the capture, so any number of threads may call it at once.
+ */
+struct QueryEngine {
+  explicit QueryEngine(ColumnarCapture capture);
+
+  [[nodiscard]] std::string answer(std::string_view request) const;
+
+ private:
+  struct SymbolRows {
+    Symbol symbol;
+    std::vector<uint32_t> trades;  // rows of the capture tables, by timestamp
+    std::vector<uint32_t> quotes;
+  };
+
+  struct Range {
+    Timestamp begin;
+    Timestamp end;
+  };
+
+  [[nodiscard]] const SymbolRows* find(std::string_view symbol) const;
+  [[nodiscard]] Timestamp parse_time(std::string_view text) const;
+  template <typename Table>
+  [[nodiscard]] std::pair<const uint32_t*, const uint32_t*> in_range(const Table& table,
+                                                                      const std::vector<uint32_t>& rows,
+                                                                      Range range) const;
+
+  std::string symbols() const;
+  std::string trades(const SymbolRows& rows, Range range) const;
+  std::string quotes(const SymbolRows& rows, Range range) const;
+  std::string stats(const SymbolRows& rows, Range range) const;
+  std::string top(std::size_t n, std::string_view measure, Range range) const;
+
+  const ColumnarCapture capture;
+  std::vector<SymbolRows> symbol_rows;               // in symbol order
+  std::unordered_map<uint64_t, std::size_t> lookup;  // symbol_key to symbol_rows index
+  Timestamp day_start = 0;                           // local midnight of the first message
+};
+
+/**
+ * Serves a QueryEngine over a Unix stream socket.
+ *
+ * The accepting thread hands every connection to a pool of worker threads. A connection may send any number of
+ * requests, one per line, and is answered in order until it closes. A line longer than 4 KiB is answered with an
+ * `ERR` and ends the connection. A connection idle for `idle_timeout` (never when zero), or for a second while other
+ * connections wait for a worker, is closed so that idle clients cannot hold every worker. A stale socket file left at
+ * `socket_path` is replaced.
+ */
+struct QueryServer {
+  QueryServer(const QueryEngine& engine, std::string socket_path, unsigned threads,
+              std::chrono::seconds idle_timeout = std::chrono::seconds(60));
+  ~QueryServer();
+
+  QueryServer(const QueryServer&) = delete;
+  QueryServer& operator=(const QueryServer&) = delete;
+
+  // Accepts connections until request_stop() is called
+  void run();
+
+  // Safe to call from a signal handler
+  static void request_stop() { stop_requested.store(true); }
+
+ private:
+  void work();
+  void serve(int fd);
+  bool waiting();
+
+  const QueryEngine& engine;
+  const std::string socket_path;
+  const std::chrono::seconds idle_timeout;
+  int listen_fd = -1;
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::queue<int> connections;
+  bool closing = false;
+
+  static inline std::atomic<bool> stop_requested{false};
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_SERVER_HPP
@@ -0,0 +1,98 @@
+#ifndef IEX_TOOLS_SHARDS_HPP
+#define IEX_TOOLS_SHARDS_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <iextoolslib/output.hpp>
+#include <iextoolslib/pcap_frames.hpp>
+#include <iextoolslib/spsc_ring.hpp>
+#include <iextoolslib/summary.hpp>
+#include <iextoolslib/taq.hpp>
+#include <iextoolslib/trade_index.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Symbol-sharded TOPS message processing.
+ *
+ * The decoding thread interns every symbol into a dense id and routes its messages to the shard `id % shard_count`
+ * through one SPSC ring per shard. A shard is the only owner of the state of its symbols, so workers need no locks,
+ * and since each symbol always goes through the same ring its messages are processed in order.
+ */
+struct TopsShards {
+  TopsShards(std::filesystem::path out_dir, unsigned shard_count, OutputOptions output = {}, bool join_quotes = false,
+             bool summary = false);
+  ~TopsShards();
+
+  TopsShards(const TopsShards&) = delete;
+  TopsShards& operator=(const TopsShards&) = delete;
+
+  // Routes the messages of a packet, called from the decoding thread
+  void route(const EnhancedPacketBlock& packet);
+
+  // Drains the shards, writes every symbol file and prints their paths
+  void finish();
+
+ private:
+  struct Record {
+    uint32_t symbol_id;
+    Byte message_type;
+    uint32_t offset;  // of the message body in Batch::bytes
+  };
+
+  // Messages copied out of the capture, so the decoder can move on while shards process them
+  struct Batch {
+    std::vector<std::byte> bytes;
+    std::vector<Record> records;
+  };
+
+  struct SymbolState {
+    std::string name;
+    std::string lines;
+    std::vector<std::pair<std::size_t, std::size_t>> broken;  // (offset, length) in `lines`, cut out when writing
+  };
+
+  struct TradePosition {
+    uint32_t local_id;
+    uint32_t length;
+    std::size_t offset;
+  };
+
+  struct Shard {
+    explicit Shard(std::size_t ring_capacity) : ring(ring_capacity) {}
+
+    SpscRing<Batch> ring;
+    Batch pending;                    // owned by the decoding thread
+    std::vector<SymbolState> states;  // owned by the worker, indexed by symbol_id / shard_count
+    QuoteJoin join;                   // owned by the worker
+    DailySummary summary;             // owned by the worker
+    TradeIndex<TradePosition> index;  // owned by the worker, trade lines by trade id
+    std::thread worker;
+  };
+
+  void work(Shard& shard);
+  void write_files(Shard& shard);
+  void push(Shard& shard);
+
+  uint32_t intern(const Symbol& symbol);
+
+  const std::filesystem::path out_dir;
+  const unsigned shard_count;
+  const bool join_quotes;
+  const bool summary;
+  OutputWriter writer;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::unordered_map<uint64_t, uint32_t> symbol_ids;
+  std::string breaks;  // breaks.csv, written by the decoding thread so lines keep the capture order
+  bool finished = false;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_SHARDS_HPP
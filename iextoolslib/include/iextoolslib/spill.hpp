@@ -0,0 +1,49 @@
+#ifndef IEX_TOOLS_SPILL_HPP
+#define IEX_TOOLS_SPILL_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <iextoolslib/output.hpp>
+#include <iextoolslib/types.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace IEXTools {
+
+// Formatted lines of a symbol not spilled yet
+struct SymbolLines {
+  std::vector<std::string> lines;  // a cleared line is a broken trade
+  std::vector<Long> trade_ids;     // of every line, empty for lines that are not trades
+};
+
+/**
+ * External sort of per-symbol lines under a memory budget.
+ *
+ * spill() writes every line held in memory as one binary run sorted by symbol, then empties the in-memory stores.
+ * Runs are spilled in capture order, so a k-way merge on (symbol, run) streams each symbol file out in its original
+ * order and the memory needed at the end does not depend on the size of the capture either. Trade ids go with the
+ * lines, so trades broken after being spilled are dropped by the merge.
+ */
+struct SpillRuns {
+  explicit SpillRuns(std::filesystem::path dir);
+  ~SpillRuns();
+
+  SpillRuns(const SpillRuns&) = delete;
+  SpillRuns& operator=(const SpillRuns&) = delete;
+
+  void spill(std::map<std::string, SymbolLines>& data);
+
+  // Writes `<SYMBOL>.csv` for every spilled symbol, leaving out the trades in `broken` (sorted)
+  void merge(const std::vector<Long>& broken, OutputWriter& writer) const;
+
+  [[nodiscard]] std::size_t size() const { return runs.size(); }
+
+ private:
+  const std::filesystem::path dir;
+  std::vector<std::filesystem::path> runs;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_SPILL_HPP
@@ -0,0 +1,94 @@
+#ifndef IEX_TOOLS_SPSC_RING_HPP
+#define IEX_TOOLS_SPSC_RING_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring.
+ *
+ * push() blocks while the ring is full, which gives backpressure to the producing stage. pop() blocks while it is
+ * empty and returns false once the producer has called close() and every queued element has been consumed.
+ */
+template <typename T>
+struct SpscRing {
+  explicit SpscRing(std::size_t capacity) : slots(std::bit_ceil(capacity < 2 ? 2 : capacity)), mask(slots.size() - 1) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  bool try_push(T& value) {
+    const auto t = tail.load(std::memory_order_relaxed);
+    if (t - cached_head > mask) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (t - cached_head > mask) {
+        return false;
+      }
+    }
+
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool try_pop(T& value) {
+    const auto h = head.load(std::memory_order_relaxed);
+    if (h == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (h == cached_tail) {
+        return false;
+      }
+    }
+
+    value = std::move(*slots[h & mask]);
+    slots[h & mask].reset();
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  void push(T value) {
+    for (unsigned spins = 0; !try_push(value); ++spins) {
+      backoff(spins);
+    }
+  }
+
+  bool pop(T& value) {
+    for (unsigned spins = 0; !try_pop(value); ++spins) {
+      if (closed.load(std::memory_order_acquire)) {
+        // the producer may have pushed right before closing
+        return try_pop(value);
+      }
+      backoff(spins);
+    }
+    return true;
+  }
+
+  void close() { closed.store(true, std::memory_order_release); }
+
+ private:
+  static void backoff(unsigned spins) {
+    if (spins > 64) {
+      std::this_thread::yield();
+    }
+  }
+
+  std::vector<std::optional<T>> slots;
+  const std::size_t mask;
+
+  alignas(64) std::atomic<std::size_t> head{0};
+  std::size_t cached_tail{0};  // consumer-side copy of tail
+  alignas(64) std::atomic<std::size_t> tail{0};
+  std::size_t cached_head{0};  // producer-side copy of head
+  alignas(64) std::atomic<bool> closed{false};
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_SPSC_RING_HPP
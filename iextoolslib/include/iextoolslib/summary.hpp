@@ -0,0 +1,78 @@
+#ifndef IEX_TOOLS_SUMMARY_HPP
+#define IEX_TOOLS_SUMMARY_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iextoolslib/output.hpp>
+#include <iextoolslib/tops_messages.hpp>
+#include <iextoolslib/trade_index.hpp>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace IEXTools {
+
+// Trades of a symbol stored column by column, so reductions run over contiguous arrays
+struct TradeColumns {
+  std::vector<Timestamp> timestamps;
+  std::vector<Integer> sizes;
+  std::vector<double> prices;
+  std::vector<std::size_t> broken;  // rows of broken trades, left out of every statistic
+
+  void push_back(const TradeReportMessage& trade) {
+    timestamps.push_back(trade.timestamp);
+    sizes.push_back(trade.size);
+    prices.push_back(trade.price);
+  }
+
+  [[nodiscard]] std::size_t size() const { return timestamps.size(); }
+
+  // Copy without the broken rows
+  [[nodiscard]] TradeColumns without_broken() const;
+};
+
+struct SymbolSummary {
+  static constexpr std::array<double, 5> PERCENTILES{0.05, 0.25, 0.5, 0.75, 0.95};
+
+  std::size_t trades = 0;
+  uint64_t volume = 0;
+  double notional = 0;
+  double high = 0;
+  double low = 0;
+  Timestamp first_time = 0;
+  Timestamp last_time = 0;
+  std::array<double, PERCENTILES.size()> price_percentiles{};
+
+  static SymbolSummary compute(const TradeColumns& columns);
+};
+
+/**
+ * Per-symbol daily trade summary.
+ *
+ * Trades are collected into TradeColumns while decoding. At the end the volume, notional, high and low of every
+ * symbol are computed with AVX2 reductions on x86 CPUs supporting them (scalar code otherwise), symbols being spread
+ * over all cores, and written as one table: summary.csv in the output directory.
+ */
+struct DailySummary {
+  void add(const TradeReportMessage& trade);
+
+  // Drops the broken trade from the statistics, unknown trade ids are ignored
+  void on_break(const TradeBreakMessage& trade_break);
+
+  // Takes over the trades of another collector with a disjoint set of symbols, once no more breaks can reach either
+  void merge(DailySummary&& other);
+
+  [[nodiscard]] std::map<std::string, SymbolSummary> compute() const;
+
+  void write(OutputWriter& writer) const;
+
+ private:
+  std::map<std::string, TradeColumns> columns;
+  TradeIndex<std::pair<TradeColumns*, std::size_t>> index;  // map nodes never move, so the pointers stay valid
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_SUMMARY_HPP
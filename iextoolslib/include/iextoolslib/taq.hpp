@@ -0,0 +1,45 @@
+#ifndef IEX_TOOLS_TAQ_HPP
+#define IEX_TOOLS_TAQ_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <iextoolslib/tops_messages.hpp>
+#include <string>
+#include <unordered_map>
+
+namespace IEXTools {
+
+/**
+ * As-of join of trades to the prevailing IEX quote of their symbol.
+ *
+ * Quotes and trades come from the same ordered stream, so remembering the last quote of every symbol is enough to know
+ * the quote in force at trade time. The trade side is classified with the Lee-Ready rule: above the midpoint is a buy,
+ * below is a sell, and at the midpoint (or without a two-sided quote) the tick test against the previous trade decides.
+ */
+struct QuoteJoin {
+  void on_quote(const QuoteUpdateMessage& quote);
+
+  // Fields appended to the csv line of a trade: bid_price,bid_size,ask_price,ask_size,side,effective_spread. Prices
+  // are empty when there is no two-sided quote, side is B, S or empty when it cannot be told
+  std::string enrich(const TradeReportMessage& trade);
+
+  // Serializes the per-symbol state, for checkpoints
+  void save(std::ostream& os) const;
+  void load(std::istream& is);
+
+ private:
+  struct State {
+    Price bid_price = 0;
+    Integer bid_size = 0;
+    Price ask_price = 0;
+    Integer ask_size = 0;
+    Price last_trade_price = 0;
+    char last_side = 0;
+  };
+
+  std::unordered_map<uint64_t, State> states;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_TAQ_HPP
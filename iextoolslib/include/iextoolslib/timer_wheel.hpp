@@ -0,0 +1,82 @@
+#ifndef IEX_TOOLS_TIMER_WHEEL_HPP
+#define IEX_TOOLS_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iextoolslib/types.hpp>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Hashed timer wheel over exchange time for deadlines at most `horizon` nanoseconds ahead.
+ *
+ * Time is cut into ticks and every tick maps to a slot, so scheduling and firing a timer are O(1). The wheel has more
+ * slots than ticks in the horizon, so a slot only ever holds timers of a single tick. Timers fire once time has
+ * reached the end of the tick holding their deadline, never early and at most one tick late. Timers cannot be
+ * cancelled, the owner ignores the ones it no longer needs.
+ */
+template <typename Id>
+struct TimerWheel {
+  TimerWheel(Timestamp horizon, std::size_t ticks_per_horizon)
+      : tick(std::max<Timestamp>(horizon / static_cast<Timestamp>(ticks_per_horizon), 1)),
+        slots(std::bit_ceil(ticks_per_horizon + 2)),
+        mask(slots.size() - 1) {}
+
+  // A deadline already reached fires on the next advance rather than a whole turn of the wheel later
+  void schedule(Timestamp deadline, Id id) {
+    auto deadline_tick = std::max<Timestamp>((deadline + tick - 1) / tick, current_tick + 1);
+    slots[static_cast<std::size_t>(deadline_tick) & mask].push_back(id);
+  }
+
+  // Moves time forward to `now`, calling `fire(id)` for every timer that became due, in deadline order. `fire` must
+  // not schedule timers
+  template <typename Fire>
+  void advance(Timestamp now, Fire&& fire) {
+    auto now_tick = now / tick;
+    if (!started) {
+      current_tick = now_tick;
+      started = true;
+      return;
+    }
+    if (now_tick <= current_tick) {
+      return;
+    }
+
+    // after a gap longer than the wheel every slot is due once
+    auto due_ticks = std::min<Timestamp>(now_tick - current_tick, static_cast<Timestamp>(slots.size()));
+    for (Timestamp t = current_tick + 1; t <= current_tick + due_ticks; ++t) {
+      auto& slot = slots[static_cast<std::size_t>(t) & mask];
+      for (auto id : slot) {
+        fire(id);
+      }
+      slot.clear();
+    }
+    current_tick = now_tick;
+  }
+
+  // Fires every pending timer regardless of its deadline
+  template <typename Fire>
+  void drain(Fire&& fire) {
+    for (std::size_t i = 1; i <= slots.size(); ++i) {
+      auto& slot = slots[static_cast<std::size_t>(current_tick + static_cast<Timestamp>(i)) & mask];
+      for (auto id : slot) {
+        fire(id);
+      }
+      slot.clear();
+    }
+  }
+
+ private:
+  const Timestamp tick;
+  std::vector<std::vector<Id>> slots;
+  const std::size_t mask;
+  Timestamp current_tick = 0;
+  bool started = false;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_TIMER_WHEEL_HPP
@@ -2,26 +2,116 @@
 #define IEX_TOOLS_TOPS_HPP
 
 #include <filesystem>
+#include <iextoolslib/checksum.hpp>
+#include <iextoolslib/columns.hpp>
+#include <iextoolslib/conflate.hpp>
+#include <iextoolslib/memory.hpp>
+#include <iextoolslib/output.hpp>
 #include <iextoolslib/pcap.hpp>
+#include <iextoolslib/shards.hpp>
+#include <iextoolslib/spill.hpp>
+#include <iextoolslib/summary.hpp>
+#include <iextoolslib/taq.hpp>
 #include <iextoolslib/tops_messages.hpp>
+#include <iextoolslib/trade_index.hpp>
 #include <map>
 #include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 
 namespace IEXTools {
+
+struct TopsOptions {
+  // overlap file reading, decoding and output writing on separate threads
+  bool pipelined = false;
+  // decode a capture that is still being written, implies pipelined
+  bool follow = false;
+  // seconds without new data after which following stops, 0 to follow until interrupted
+  unsigned follow_idle_timeout = 0;
+  // levels per side in the book snapshots of a DEEP capture, 0 for TOPS processing
+  std::size_t book_depth = 0;
+  // worker threads processing the decoded messages, each owning a subset of the symbols
+  unsigned shards = 1;
+  OutputOptions output;
+  // append the prevailing quote, trade side and effective spread to every trade
+  bool join_quotes = false;
+  // seconds between checkpoints of the progress in out_dir, 0 to disable them. Implies pipelined
+  unsigned checkpoint_interval = 0;
+  // continue from the checkpoint left in out_dir by an interrupted run. Implies pipelined
+  bool resume = false;
+  // write a per-symbol daily summary table, see DailySummary
+  bool summary = false;
+  // verify the IPv4 and UDP checksums and quarantine failing packets, see PacketVerifier
+  bool verify_checksums = false;
+  // split the capture by (protocol, channel, session) and decode every stream on its own thread, see StreamDemux
+  bool demux = false;
+  // approximate bytes of formatted trades kept in memory before they are spilled to sorted runs on disk, 0 for no
+  // limit, see SpillRuns
+  std::size_t memory_budget = 0;
+  // write the quotes of every symbol to <SYMBOL>.quotes.csv, thinned out as set here, see QuoteConflator
+  ConflationOptions conflation;
+  // directory of decoded captures reused across runs instead of parsing the capture again, see CaptureCache
+  std::string cache_dir;
+  // bytes the run tries to stay within, 0 for no limit. Split over the subsystems as MemoryLimits does: the capture
+  // is read in smaller chunks, memory_budget and output.buffer_limit are lowered to their shares
+  std::size_t memory_limit = 0;
+};
+
 struct TopsReader {
-  TopsReader(const std::string& file_path, const std::string& out_dir);
+  // Broken trades are listed in breaks.csv. Lower case, so it never collides with a symbol file
+  static constexpr const char* BREAKS = "breaks";
+
+  TopsReader(const std::string& file_path, const std::string& out_dir, TopsOptions options = {});
 
   void parse_data();
 
+  // Decodes the trades of an IEX-TP packet into (symbol, csv line) pairs, feeding quotes to `join` and trades to
+  // `summary` when given. Lines already handed out cannot be taken back, so breaks become (BREAKS, line) pairs.
+  // Quotes let through by `conflator` become (<SYMBOL>.quotes, line) pairs
+  static void format_trades(const IexTpFrame& iex_tp, std::vector<std::pair<std::string, std::string>>& lines,
+                            QuoteJoin* join = nullptr, DailySummary* summary = nullptr,
+                            QuoteConflator* conflator = nullptr);
+  static void format_trades(const EnhancedPacketBlock& packet, std::vector<std::pair<std::string, std::string>>& lines,
+                            QuoteJoin* join = nullptr, DailySummary* summary = nullptr,
+                            QuoteConflator* conflator = nullptr) {
+    format_trades(packet.iex_tp, lines, join, summary, conflator);
+  }
+  static std::string format_trade(const TradeReportMessage& message, QuoteJoin* join = nullptr);
+  // symbol,timestamp,size,price,trade_id of the broken trade
+  static std::string format_break(const TradeBreakMessage& message);
+
  private:
-  std::vector<std::unique_ptr<TopsMessage>> get_messages(EnhancedPacketBlock* packet);
+  std::vector<std::unique_ptr<TopsMessage>> get_messages(const EnhancedPacketBlock* packet);
 
-  PcapReader pcap;
-  std::map<std::string, std::vector<std::string>> data;
+  const TopsOptions options;
+  std::optional<PcapReader> pcap;
+  std::map<std::string, SymbolLines> data;
+  // store and row of each trade line in `data`, broken trades have their line cleared and are skipped when dumping
+  TradeIndex<std::pair<SymbolLines*, std::size_t>> trade_lines;
+  std::size_t buffered_bytes = 0;
+  std::optional<SpillRuns> runs;
+  std::vector<Long> spilled_breaks;  // breaks of trades no longer in memory, applied by the merge
   std::filesystem::path out_dir;
+  std::optional<TopsShards> shards;
+  std::optional<QuoteJoin> join;
+  std::optional<DailySummary> summary;
+  std::optional<PacketVerifier> verifier;
+  std::optional<QuoteConflator> conflator;
+  QuoteConflator::Lines quote_lines;
 
-  void dump_files() const;
+  // Reads the capture in chunks, each decoded into columns by a ColumnDecoder and then fed to parse_columns()
+  void parse_chunks(const std::string& file_path);
+  // Feeds the messages of `capture` in their original order
+  void parse_columns(const ColumnarCapture& capture);
+  void on_packet(Timestamp send_time);
+  void on_trade(const TradeReportMessage& message);
+  void on_quote(const QuoteUpdateMessage& message);
+  void on_break(const TradeBreakMessage& message);
+  void count_line(const std::string& line);
+  void spill_if_needed();
+  void store_quotes();
+  void dump_files();
 };
 
 }  // namespace IEXTools
@@ -53,6 +53,9 @@ struct TradeBreakMessage : public TopsMessage {
   const uint32_t size;
   const int64_t price;
   const int64_t trade_id;
+
+  // Same layout as a trade report, the fields are those of the broken trade
+  static std::unique_ptr<TradeBreakMessage> from_raw_message(pcap_cit_t it);
 };
 
 struct SecurityDirectoryMessage : public TopsMessage {
@@ -0,0 +1,100 @@
+#ifndef IEX_TOOLS_TRADE_INDEX_HPP
+#define IEX_TOOLS_TRADE_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iextoolslib/types.hpp>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace IEXTools {
+
+/**
+ * Open-addressing hash index from trade id to where the trade is stored, used to find the trade a TradeBreakMessage
+ * refers to in O(1).
+ *
+ * Linear probing over a power-of-two table kept at most half full. Erasing shifts the following entries of the
+ * probe run back, so lookups never walk over tombstones.
+ */
+template <typename Value>
+struct TradeIndex {
+  void insert(Long trade_id, Value value) {
+    if ((count + 1) * 2 > slots.size()) {
+      grow();
+    }
+    auto i = find_slot(trade_id);
+    if (slots[i].trade_id == EMPTY) {
+      ++count;
+    }
+    slots[i] = {trade_id, value};
+  }
+
+  // Removes the trade from the index and returns where it was stored, nothing when it is unknown
+  std::optional<Value> erase(Long trade_id) {
+    if (slots.empty()) {
+      return std::nullopt;
+    }
+    auto i = find_slot(trade_id);
+    if (slots[i].trade_id == EMPTY) {
+      return std::nullopt;
+    }
+
+    auto value = slots[i].value;
+    const auto mask = slots.size() - 1;
+    for (auto j = (i + 1) & mask; slots[j].trade_id != EMPTY; j = (j + 1) & mask) {
+      // an entry may move back to the hole unless its home slot lies cyclically between the hole and itself
+      auto home = hash(slots[j].trade_id) & mask;
+      if (((j - home) & mask) >= ((j - i) & mask)) {
+        slots[i] = slots[j];
+        i = j;
+      }
+    }
+    slots[i].trade_id = EMPTY;
+    --count;
+    return value;
+  }
+
+  [[nodiscard]] std::size_t size() const { return count; }
+
+ private:
+  static constexpr Long EMPTY = std::numeric_limits<Long>::min();
+  static const std::size_t INITIAL_CAPACITY = 1024;
+
+  struct Slot {
+    Long trade_id = EMPTY;
+    Value value{};
+  };
+
+  static std::size_t hash(Long trade_id) {
+    // trade ids are mostly consecutive, mix them so neighbours do not share probe runs
+    auto x = static_cast<uint64_t>(trade_id) * 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(x ^ (x >> 32));
+  }
+
+  std::size_t find_slot(Long trade_id) const {
+    const auto mask = slots.size() - 1;
+    auto i = hash(trade_id) & mask;
+    while (slots[i].trade_id != EMPTY && slots[i].trade_id != trade_id) {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  void grow() {
+    std::vector<Slot> old(slots.empty() ? INITIAL_CAPACITY : slots.size() * 2);
+    old.swap(slots);
+    for (const auto& slot : old) {
+      if (slot.trade_id != EMPTY) {
+        slots[find_slot(slot.trade_id)] = slot;
+      }
+    }
+  }
+
+  std::vector<Slot> slots;
+  std::size_t count = 0;
+};
+
+}  // namespace IEXTools
+
+#endif  // IEX_TOOLS_TRADE_INDEX_HPP
@@ -29,6 +29,13 @@ enum TopsType {
   OfficialPriceType = 0x58
 };
 
+enum MessageProtocol { TopsProtocol = 0x8003, DeepProtocol = 0x8004 };
+
+// DEEP specific messages, the rest of the DEEP messages share their layout and type with TOPS
+enum DeepType { PriceLevelUpdateSellType = 0x35, PriceLevelUpdateBuyType = 0x38, SecurityEventType = 0x45 };
+
+enum Side { Buy, Sell };
+
 enum TradingStatus {
   HaltedAllUSMarkets = 0x48,
   HaltReleaseOrderAcceptance = 0x4f,
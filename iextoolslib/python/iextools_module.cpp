@@ -0,0 +1,272 @@
+// CPython extension exposing ColumnarCapture to Python. Every column supports the buffer protocol, so
+// numpy.asarray(column) or memoryview(column) views the decoded C++ vector in place instead of copying it.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <filesystem>
+#include <iextoolslib/cache.hpp>
+#include <iextoolslib/columns.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+
+using namespace IEXTools;
+
+namespace {
+
+struct Column {
+  PyObject_HEAD
+  std::shared_ptr<const ColumnarCapture> owner;  // keeps the vectors alive while views exist
+  const void* data;
+  Py_ssize_t shape[1];
+  Py_ssize_t strides[1];
+  Py_ssize_t itemsize;
+  const char* format;
+};
+
+void column_dealloc(PyObject* self) {
+  reinterpret_cast<Column*>(self)->owner.~shared_ptr();
+  Py_TYPE(self)->tp_free(self);
+}
+
+int column_getbuffer(PyObject* self, Py_buffer* view, int flags) {
+  if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "iextools columns are read-only");
+    return -1;
+  }
+
+  auto* column = reinterpret_cast<Column*>(self);
+  Py_INCREF(self);
+  view->obj = self;
+  view->buf = const_cast<void*>(column->data);
+  view->len = column->shape[0] * column->itemsize;
+  view->readonly = 1;
+  view->itemsize = column->itemsize;
+  view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(column->format) : nullptr;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) ? column->shape : nullptr;
+  view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? column->strides : nullptr;
+  view->suboffsets = nullptr;
+  view->internal = nullptr;
+  return 0;
+}
+
+Py_ssize_t column_length(PyObject* self) { return reinterpret_cast<Column*>(self)->shape[0]; }
+
+PyBufferProcs column_buffer_procs = {column_getbuffer, nullptr};
+
+PySequenceMethods column_sequence_methods = [] {
+  PySequenceMethods methods{};
+  methods.sq_length = column_length;
+  return methods;
+}();
+
+PyTypeObject ColumnType = [] {
+  PyTypeObject type{};
+  type.ob_base = PyVarObject{PyObject_HEAD_INIT(nullptr) 0};
+  type.tp_name = "iextools.Column";
+  type.tp_basicsize = sizeof(Column);
+  type.tp_dealloc = column_dealloc;
+  type.tp_as_sequence = &column_sequence_methods;
+  type.tp_as_buffer = &column_buffer_procs;
+  type.tp_flags = Py_TPFLAGS_DEFAULT;
+  type.tp_doc = "Read-only view of a decoded column, use numpy.asarray() or memoryview() on it";
+  return type;
+}();
+
+template <typename T>
+const char* buffer_format() {
+  if constexpr (std::is_same_v<T, Symbol>) {
+    return "8s";  // numpy dtype S8, space padded like on the wire
+  } else if constexpr (std::is_same_v<T, double>) {
+    return "d";
+  } else if constexpr (std::is_same_v<T, Integer>) {
+    return "I";
+  } else if constexpr (std::is_same_v<T, Byte>) {
+    return "B";
+  } else {
+    static_assert(std::is_same_v<T, int64_t>);
+    return "q";
+  }
+}
+
+template <typename T>
+bool add_column(PyObject* dict, const char* name, const IEXTools::Column<T>& values,
+                const std::shared_ptr<const ColumnarCapture>& owner) {
+  auto* column = PyObject_New(Column, &ColumnType);
+  if (column == nullptr) {
+    return false;
+  }
+  new (&column->owner) std::shared_ptr<const ColumnarCapture>(owner);
+  column->data = values.data();
+  column->shape[0] = static_cast<Py_ssize_t>(values.size());
+  column->strides[0] = sizeof(T);
+  column->itemsize = sizeof(T);
+  column->format = buffer_format<T>();
+
+  auto result = PyDict_SetItemString(dict, name, reinterpret_cast<PyObject*>(column));
+  Py_DECREF(column);
+  return result == 0;
+}
+
+PyObject* trades_dict(const std::shared_ptr<const ColumnarCapture>& capture) {
+  const auto& t = capture->trades;
+  auto* dict = PyDict_New();
+  if (dict == nullptr || !add_column(dict, "timestamp", t.timestamp, capture) ||
+      !add_column(dict, "symbol", t.symbol, capture) || !add_column(dict, "size", t.size, capture) ||
+      !add_column(dict, "price", t.price, capture) || !add_column(dict, "trade_id", t.trade_id, capture) ||
+      !add_column(dict, "flags", t.flags, capture)) {
+    Py_XDECREF(dict);
+    return nullptr;
+  }
+  return dict;
+}
+
+PyObject* quotes_dict(const std::shared_ptr<const ColumnarCapture>& capture) {
+  const auto& q = capture->quotes;
+  auto* dict = PyDict_New();
+  if (dict == nullptr || !add_column(dict, "timestamp", q.timestamp, capture) ||
+      !add_column(dict, "symbol", q.symbol, capture) || !add_column(dict, "bid_size", q.bid_size, capture) ||
+      !add_column(dict, "bid_price", q.bid_price, capture) || !add_column(dict, "ask_price", q.ask_price, capture) ||
+      !add_column(dict, "ask_size", q.ask_size, capture) || !add_column(dict, "flags", q.flags, capture)) {
+    Py_XDECREF(dict);
+    return nullptr;
+  }
+  return dict;
+}
+
+bool parse_symbols(PyObject* symbols, ColumnFilter& filter) {
+  if (symbols == Py_None) {
+    return true;
+  }
+
+  auto* iterator = PyObject_GetIter(symbols);
+  if (iterator == nullptr) {
+    return false;
+  }
+  while (auto* item = PyIter_Next(iterator)) {
+    Py_ssize_t length = 0;
+    const char* name = PyUnicode_AsUTF8AndSize(item, &length);
+    Py_DECREF(item);
+    if (name == nullptr || length > static_cast<Py_ssize_t>(sizeof(Symbol))) {
+      if (name != nullptr) {
+        PyErr_SetString(PyExc_ValueError, "symbols are at most 8 characters");
+      }
+      Py_DECREF(iterator);
+      return false;
+    }
+    Symbol symbol;
+    symbol.fill(' ');
+    std::copy(name, name + length, symbol.begin());
+    filter.symbols.push_back(symbol);
+  }
+  Py_DECREF(iterator);
+  return !PyErr_Occurred();
+}
+
+PyObject* decode(PyObject*, PyObject* args, PyObject* kwargs) {
+  static const char* keywords[] = {"path", "symbols", "start", "end", "cache", nullptr};
+  const char* path = nullptr;
+  PyObject* symbols = Py_None;
+  PyObject* start = Py_None;
+  PyObject* end = Py_None;
+  const char* cache = nullptr;
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|O$OOz", const_cast<char**>(keywords), &path, &symbols, &start,
+                                   &end, &cache)) {
+    return nullptr;
+  }
+
+  ColumnFilter filter;
+  if (!parse_symbols(symbols, filter)) {
+    return nullptr;
+  }
+  if (start != Py_None && (filter.begin = PyLong_AsLongLong(start)) == -1 && PyErr_Occurred()) {
+    return nullptr;
+  }
+  if (end != Py_None && (filter.end = PyLong_AsLongLong(end)) == -1 && PyErr_Occurred()) {
+    return nullptr;
+  }
+
+  std::string file_path(path);
+  std::string cache_dir(cache != nullptr ? cache : "");
+  auto filtered = symbols != Py_None || start != Py_None || end != Py_None;
+  if (!std::filesystem::is_regular_file(file_path)) {
+    PyErr_Format(PyExc_FileNotFoundError, "no such capture: '%s'", path);
+    return nullptr;
+  }
+
+  std::shared_ptr<ColumnarCapture> capture;
+  std::string error;
+  PyObject* error_type = PyExc_RuntimeError;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    if (cache_dir.empty()) {
+      capture = std::make_shared<ColumnarCapture>(ColumnarCapture::decode(file_path, filter));
+    } else {
+      auto cached = CaptureCache(cache_dir).load(file_path);
+      capture = std::make_shared<ColumnarCapture>(filtered ? cached.select(filter) : std::move(cached));
+    }
+  } catch (const CaptureError& e) {
+    // a malformed capture, see throw_capture_errors()
+    error = e.what();
+    error_type = PyExc_ValueError;
+  } catch (const std::exception& e) {
+    error = e.what();
+  }
+  Py_END_ALLOW_THREADS
+  if (!capture) {
+    PyErr_SetString(error_type, error.c_str());
+    return nullptr;
+  }
+
+  auto* trades = trades_dict(capture);
+  auto* quotes = trades != nullptr ? quotes_dict(capture) : nullptr;
+  if (quotes == nullptr) {
+    Py_XDECREF(trades);
+    return nullptr;
+  }
+  return Py_BuildValue("{sNsN}", "trades", trades, "quotes", quotes);
+}
+
+PyMethodDef methods[] = {
+    {"decode", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(decode)), METH_VARARGS | METH_KEYWORDS,
+     "decode(path, symbols=None, *, start=None, end=None, cache=None)\n\n"
+     "Decodes the trades and quotes of a TOPS capture into {'trades': {...}, 'quotes': {...}}, one read-only Column per "
+     "field. Only messages of the given symbols with start <= timestamp < end (nanoseconds) are kept. With a cache "
+     "directory the decoded capture is stored there once and mapped by later calls instead of being decoded again."},
+    {nullptr, nullptr, 0, nullptr}};
+
+PyModuleDef module = [] {
+  PyModuleDef def{};
+  def.m_base = PyModuleDef_HEAD_INIT;
+  def.m_name = "iextools";
+  def.m_doc = "IEX market data decoding";
+  def.m_size = -1;
+  def.m_methods = methods;
+  return def;
+}();
+
+}  // namespace
+
+PyMODINIT_FUNC PyInit_iextools() {
+  // a malformed capture raises ValueError instead of ending the interpreter
+  throw_capture_errors();
+  if (PyType_Ready(&ColumnType) < 0) {
+    return nullptr;
+  }
+
+  auto* m = PyModule_Create(&module);
+  if (m == nullptr) {
+    return nullptr;
+  }
+  Py_INCREF(&ColumnType);
+  if (PyModule_AddObject(m, "Column", reinterpret_cast<PyObject*>(&ColumnType)) < 0) {
+    Py_DECREF(&ColumnType);
+    Py_DECREF(m);
+    return nullptr;
+  }
+  return m;
+}
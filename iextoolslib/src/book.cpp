@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <iextoolslib/book.hpp>
+
+using namespace IEXTools;
+
+bool PriceLevelBook::apply(const PriceLevelUpdateMessage& update) {
+  if (!update.event_complete()) {
+    pending.push_back({update.side, update.price, update.size});
+    return false;
+  }
+
+  for (const auto& p : pending) {
+    this->update(p.side, p.price, p.size);
+  }
+  pending.clear();
+  this->update(update.side, update.price, update.size);
+  timestamp = update.timestamp;
+
+  return true;
+}
+
+void PriceLevelBook::update(Side side, Price price, Integer size) {
+  auto& l = side == Buy ? bids : asks;
+  // position of the first level that is not worse than `price`
+  auto it = side == Buy ? std::lower_bound(l.begin(), l.end(), price,
+                                           [](const PriceLevel& a, Price p) { return a.price < p; })
+                        : std::lower_bound(l.begin(), l.end(), price,
+                                           [](const PriceLevel& a, Price p) { return a.price > p; });
+  bool found = it != l.end() && it->price == price;
+
+  if (size == 0) {
+    if (found) {
+      l.erase(it);
+    }
+  } else if (found) {
+    it->size = size;
+  } else {
+    l.insert(it, {price, size});
+  }
+}
+
+BookSnapshot PriceLevelBook::snapshot(std::size_t max_depth) const {
+  BookSnapshot s{timestamp, {}, {}};
+
+  auto bid_depth = std::min(max_depth, bids.size());
+  auto ask_depth = std::min(max_depth, asks.size());
+  s.bids.assign(bids.rbegin(), bids.rbegin() + static_cast<std::ptrdiff_t>(bid_depth));
+  s.asks.assign(asks.rbegin(), asks.rbegin() + static_cast<std::ptrdiff_t>(ask_depth));
+
+  return s;
+}
+
+PriceLevelBook* DeepBookBuilder::apply(const PriceLevelUpdateMessage& update) {
+  auto& book = books[symbol_key(update.symbol)];
+
+  return book.apply(update) ? &book : nullptr;
+}
+
+const PriceLevelBook* DeepBookBuilder::find(const Symbol& symbol) const {
+  auto it = books.find(symbol_key(symbol));
+  return it != books.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,208 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iextoolslib/cache.hpp>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace IEXTools;
+
+// bump whenever the decoded columns or the entry layout change
+static const uint32_t CACHE_VERSION = 1;
+static const char CACHE_MAGIC[8] = {'I', 'E', 'X', 'C', 'O', 'L', 'S', '\0'};
+static const std::size_t COLUMN_ALIGNMENT = 64;
+static const std::size_t SAMPLES = 16;
+static const std::size_t SAMPLE_SIZE = 4 << 10;
+
+namespace {
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t trades;
+  uint64_t quotes;
+  uint64_t breaks;
+  uint64_t events;
+  uint64_t packets;
+  uint64_t size;  // of the whole entry, a shorter file is an interrupted store
+};
+
+// FNV-1a, plenty for telling captures apart
+uint64_t hash_bytes(uint64_t hash, const void* data, std::size_t size) {
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+std::size_t aligned(std::size_t offset) {
+  return (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+}
+
+enum Rows { TRADES, BREAKS, QUOTES, EVENTS, PACKETS };
+
+// Calls `f(column, rows)` on every column of the capture, in entry order
+template <typename Capture, typename F>
+void for_each_column(Capture& capture, F&& f) {
+  for (auto [table, rows] : {std::pair{&capture.trades, TRADES}, std::pair{&capture.breaks, BREAKS}}) {
+    f(table->timestamp, rows);
+    f(table->symbol, rows);
+    f(table->size, rows);
+    f(table->price, rows);
+    f(table->trade_id, rows);
+    f(table->flags, rows);
+  }
+  auto& quotes = capture.quotes;
+  f(quotes.timestamp, QUOTES);
+  f(quotes.symbol, QUOTES);
+  f(quotes.bid_size, QUOTES);
+  f(quotes.bid_price, QUOTES);
+  f(quotes.ask_price, QUOTES);
+  f(quotes.ask_size, QUOTES);
+  f(quotes.flags, QUOTES);
+  f(capture.events, EVENTS);
+  f(capture.packets, PACKETS);
+}
+
+// Bytes of the entry of a capture with these row counts
+std::size_t entry_size(const std::array<uint64_t, 5>& rows) {
+  const ColumnarCapture empty;
+  std::size_t size = aligned(sizeof(Header));
+  for_each_column(empty, [&](const auto& column, Rows r) {
+    size = aligned(size + rows[r] * sizeof(*column.data()));
+  });
+  return size;
+}
+
+}  // namespace
+
+CaptureCache::CaptureCache(std::filesystem::path dir) : dir(std::move(dir)) {
+  std::filesystem::create_directories(this->dir);
+}
+
+std::string CaptureCache::key(const std::string& file_path) {
+  struct stat st {};
+  if (::stat(file_path.c_str(), &st) != 0) {
+    capture_error("Cannot stat '" + file_path + "': " + std::strerror(errno));
+  }
+
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = hash_bytes(hash, &CACHE_VERSION, sizeof(CACHE_VERSION));
+  hash = hash_bytes(hash, &st.st_size, sizeof(st.st_size));
+  hash = hash_bytes(hash, &st.st_mtim, sizeof(st.st_mtim));
+
+  // evenly spaced samples, the first and last included, catch captures rewritten in place with the same size
+  std::ifstream is(file_path, std::ios::binary);
+  std::vector<char> sample(SAMPLE_SIZE);
+  auto size = static_cast<std::size_t>(st.st_size);
+  auto span = size > SAMPLE_SIZE ? size - SAMPLE_SIZE : 0;
+  for (std::size_t i = 0; i < SAMPLES; ++i) {
+    is.seekg(static_cast<std::streamoff>(span / (SAMPLES - 1) * i));
+    is.read(sample.data(), static_cast<std::streamsize>(sample.size()));
+    hash = hash_bytes(hash, sample.data(), static_cast<std::size_t>(is.gcount()));
+    is.clear();
+  }
+
+  std::ostringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+}
+
+ColumnarCapture CaptureCache::load(const std::string& file_path) const {
+  auto path = dir / (key(file_path) + ".cols");
+  if (std::filesystem::exists(path)) {
+    auto capture = map(path);
+    if (capture.storage) {
+      return capture;
+    }
+    std::cerr << "Ignoring unreadable cache entry " << path << std::endl;
+  }
+
+  store(ColumnarCapture::decode(file_path), path);
+  return map(path);
+}
+
+void CaptureCache::store(const ColumnarCapture& capture, const std::filesystem::path& path) {
+  Header header{};
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  header.trades = capture.trades.rows();
+  header.quotes = capture.quotes.rows();
+  header.breaks = capture.breaks.rows();
+  header.events = capture.events.size();
+  header.packets = capture.packets.size();
+  header.size = entry_size({header.trades, header.breaks, header.quotes, header.events, header.packets});
+
+  // written under a temporary name and renamed, so concurrent runs never map a partial entry
+  auto temporary = path;
+  temporary += ".tmp" + std::to_string(::getpid());
+  std::ofstream os(temporary, std::ios::binary);
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  std::size_t offset = sizeof(header);
+  static const std::array<char, COLUMN_ALIGNMENT> padding{};
+  auto pad = [&os, &offset] {
+    os.write(padding.data(), static_cast<std::streamsize>(aligned(offset) - offset));
+    offset = aligned(offset);
+  };
+  pad();
+  for_each_column(capture, [&](const auto& column, Rows) {
+    auto bytes = column.size() * sizeof(*column.data());
+    os.write(reinterpret_cast<const char*>(column.data()), static_cast<std::streamsize>(bytes));
+    offset += bytes;
+    pad();
+  });
+
+  os.close();
+  if (!os) {
+    capture_error("Error writing cache entry " + temporary.string());
+  }
+  std::filesystem::rename(temporary, path);
+}
+
+ColumnarCapture CaptureCache::map(const std::filesystem::path& path) {
+  ColumnarCapture capture;
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return capture;
+  }
+  struct stat st {};
+  ::fstat(fd, &st);
+  auto size = static_cast<std::size_t>(st.st_size);
+  void* data = size >= sizeof(Header) ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return capture;
+  }
+  std::shared_ptr<const void> storage(data, [size](const void* p) { ::munmap(const_cast<void*>(p), size); });
+
+  Header header;
+  std::memcpy(&header, data, sizeof(header));
+  std::array<uint64_t, 5> rows{header.trades, header.breaks, header.quotes, header.events, header.packets};
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+      header.size != size || entry_size(rows) != size) {
+    return capture;
+  }
+
+  const auto* base = static_cast<const std::byte*>(data);
+  std::size_t offset = aligned(sizeof(Header));
+  for_each_column(capture, [&](auto& column, Rows r) {
+    using T = std::remove_cv_t<std::remove_pointer_t<decltype(column.data())>>;
+    column.view(reinterpret_cast<const T*>(base + offset), rows[r]);
+    offset = aligned(offset + rows[r] * sizeof(T));
+  });
+
+  capture.storage = std::move(storage);
+  return capture;
+}
@@ -0,0 +1,70 @@
+#include <cstdio>
+#include <fstream>
+#include <iextoolslib/checkpoint.hpp>
+#include <iostream>
+
+using namespace IEXTools;
+
+static const char* CHECKPOINT_MAGIC = "iex-checkpoint-1";
+
+void Checkpoint::save(const std::filesystem::path& out_dir) const {
+  auto path = out_dir / FILE_NAME;
+  auto tmp_path = out_dir / (std::string(FILE_NAME) + ".tmp");
+
+  {
+    std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+    os << CHECKPOINT_MAGIC << "\n"
+       << offset << " " << last_sequence << " " << join_quotes << " " << static_cast<int>(compression) << "\n"
+       << files.size() << "\n";
+    for (const auto& [symbol, size] : files) {
+      os << symbol << " " << size << "\n";
+    }
+    os << state.size() << "\n";
+    os.write(state.data(), static_cast<std::streamsize>(state.size()));
+
+    if (!os) {
+      std::cerr << "Error writing checkpoint " << tmp_path << std::endl;
+      std::exit(1);
+    }
+  }
+
+  // sync the data before the rename and the directory after it, so a crash leaves the old or the new checkpoint
+  sync_path(tmp_path);
+  std::filesystem::rename(tmp_path, path);
+  sync_path(out_dir);
+}
+
+std::optional<Checkpoint> Checkpoint::load(const std::filesystem::path& out_dir) {
+  std::ifstream is(out_dir / FILE_NAME, std::ios::binary);
+  if (!is) {
+    return std::nullopt;
+  }
+
+  Checkpoint c;
+  std::string magic;
+  int compression = 0;
+  std::size_t file_count = 0;
+  std::size_t state_size = 0;
+
+  is >> magic >> c.offset >> c.last_sequence >> c.join_quotes >> compression >> file_count;
+  c.compression = static_cast<Compression>(compression);
+  for (std::size_t i = 0; i < file_count && is; ++i) {
+    std::string symbol;
+    uintmax_t size = 0;
+    is >> symbol >> size;
+    c.files.emplace(symbol, size);
+  }
+  is >> state_size;
+  is.get();  // new line before the state
+  c.state.resize(state_size);
+  is.read(c.state.data(), static_cast<std::streamsize>(state_size));
+
+  if (!is || magic != CHECKPOINT_MAGIC) {
+    std::cerr << "Corrupted checkpoint " << out_dir / FILE_NAME << std::endl;
+    std::exit(1);
+  }
+
+  return c;
+}
+
+void Checkpoint::remove(const std::filesystem::path& out_dir) { std::filesystem::remove(out_dir / FILE_NAME); }
@@ -0,0 +1,129 @@
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iextoolslib/checksum.hpp>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace IEXTools;
+
+namespace {
+
+// offsets inside an enhanced packet block
+const std::size_t PACKET_DATA_OFFSET = 28;  // block type, length, interface, timestamp and lengths
+const std::size_t ETHERNET_HEADER_LENGTH = 14;
+
+uint64_t sum_scalar(const std::byte* data, std::size_t length, uint64_t sum) {
+  std::size_t i = 0;
+  for (; i + 2 <= length; i += 2) {
+    uint16_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    sum += word;
+  }
+  if (i < length) {
+    // odd length, the missing byte counts as zero
+    sum += std::to_integer<uint8_t>(data[i]);
+  }
+  return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) uint64_t sum_avx2(const std::byte* data, std::size_t length, uint64_t sum) {
+  const auto zero = _mm256_setzero_si256();
+  auto acc = _mm256_setzero_si256();
+  std::size_t i = 0;
+
+  // 32 bit lanes take at least 65537 additions of 16 bit words to overflow, far more than a packet holds
+  for (; i + 32 <= length; i += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+    acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+  }
+
+  alignas(32) uint32_t lanes[8];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+  for (auto lane : lanes) {
+    sum += lane;
+  }
+
+  return sum_scalar(data + i, length - i, sum);
+}
+#endif
+
+}  // namespace
+
+uint16_t IEXTools::ones_complement_sum(const std::byte* data, std::size_t length, uint64_t initial) {
+#if defined(__x86_64__) || defined(__i386__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+
+  auto sum = has_avx2 ? sum_avx2(data, length, initial) : sum_scalar(data, length, initial);
+#else
+  auto sum = sum_scalar(data, length, initial);
+#endif
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return static_cast<uint16_t>(sum);
+}
+
+bool PacketVerifier::verify(const PcapFrame& frame, const EnhancedPacketBlock& packet) {
+  ++verified;
+
+  const auto* ip = &*frame.iterator + PACKET_DATA_OFFSET + ETHERNET_HEADER_LENGTH;
+  const auto ip_header_length = static_cast<std::size_t>(packet.ip.ihl) * 4;
+  bool ip_ok = ones_complement_sum(ip, ip_header_length) == 0xffff;
+
+  bool udp_ok = true;
+  if (ETHERNET_HEADER_LENGTH + ip_header_length + packet.udp.length > packet.captured_packet_length) {
+    udp_ok = false;  // truncated capture or corrupted length, the datagram cannot be summed
+  } else if (packet.udp.checksum != 0) {
+    // pseudo header: source and destination addresses, protocol and UDP length
+    std::array<std::byte, 12> pseudo{};
+    std::memcpy(pseudo.data(), ip + 12, 8);
+    pseudo[9] = std::byte{IP_FRAME_TRANSPORT_PROTOCOL_UDP};
+    pseudo[10] = static_cast<std::byte>(packet.udp.length >> 8);
+    pseudo[11] = static_cast<std::byte>(packet.udp.length & 0xff);
+
+    auto partial = ones_complement_sum(pseudo.data(), pseudo.size());
+    udp_ok = ones_complement_sum(ip + ip_header_length, packet.udp.length, partial) == 0xffff;
+  }
+
+  if (ip_ok && udp_ok) {
+    return true;
+  }
+
+  bad_ip += ip_ok ? 0 : 1;
+  bad_udp += udp_ok ? 0 : 1;
+  write_quarantined(frame);
+  return false;
+}
+
+void PacketVerifier::write_quarantined(const PcapFrame& frame) {
+  if (!quarantine.is_open()) {
+    // minimal section header and ethernet interface description so the quarantined blocks form a valid capture. A
+    // resumed run appends a new section, which pcap-ng allows; packets quarantined after its checkpoint show up again
+    const uint32_t header[] = {0x0A0D0D0A, 28, 0x1A2B3C4D, 0x00000001, 0xffffffff, 0xffffffff, 28,
+                               0x00000001, 20, 0x00000001, 0x00000000, 20};
+    quarantine.open(out_dir / "quarantine.pcapng", std::ios::binary | std::ios::app);
+    if (!quarantine) {
+      std::cerr << "Cannot open " << (out_dir / "quarantine.pcapng").string() << std::endl;
+      std::exit(1);
+    }
+    quarantine.write(reinterpret_cast<const char*>(header), sizeof(header));
+  }
+  // flushed right away, bad packets are rare and must survive a crash
+  quarantine.write(reinterpret_cast<const char*>(&*frame.iterator), frame.frame_length);
+  quarantine.flush();
+}
+
+void PacketVerifier::finish() const {
+  std::cerr << "Checksums: " << verified << " packets verified, " << bad_ip << " bad IPv4 headers, " << bad_udp
+            << " bad UDP checksums" << std::endl;
+
+  if (quarantine.is_open()) {
+    std::cerr << "Quarantined packets written to " << (out_dir / "quarantine.pcapng").string() << std::endl;
+  }
+}
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iextoolslib/columns.hpp>
+#include <iextoolslib/memory.hpp>
+#include <iextoolslib/pcap.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <memory_resource>
+
+using namespace IEXTools;
+
+namespace {
+
+constexpr std::size_t READ_CHUNK_SIZE = 8 << 20;
+constexpr std::size_t BATCH = 1024;
+
+// Field offsets in a message body, right after the type byte. A break has the layout of a trade report
+constexpr std::size_t FLAGS = 0;
+constexpr std::size_t TIMESTAMP = 1;
+constexpr std::size_t SYMBOL = 9;
+constexpr std::size_t SIZE = 17;
+constexpr std::size_t PRICE = 21;
+constexpr std::size_t TRADE_ID = 29;
+constexpr std::size_t BID_SIZE = 17;
+constexpr std::size_t BID_PRICE = 21;
+constexpr std::size_t ASK_PRICE = 29;
+constexpr std::size_t ASK_SIZE = 37;
+
+template <typename T>
+T field(const std::byte* message, std::size_t offset) {
+  T value;
+  std::memcpy(&value, message + offset, sizeof(T));
+  return value;
+}
+
+// Pointers to the rows [begin, begin + n) of every column of a table, grown by n
+struct TradeRows {
+  explicit TradeRows(TradeTable& t, std::size_t n)
+      : flags(t.flags.grow(n)),
+        timestamp(t.timestamp.grow(n)),
+        symbol(t.symbol.grow(n)),
+        size(t.size.grow(n)),
+        price(t.price.grow(n)),
+        trade_id(t.trade_id.grow(n)) {}
+
+  Byte* flags;
+  Timestamp* timestamp;
+  Symbol* symbol;
+  Integer* size;
+  double* price;
+  Long* trade_id;
+};
+
+struct QuoteRows {
+  explicit QuoteRows(QuoteTable& t, std::size_t n)
+      : flags(t.flags.grow(n)),
+        timestamp(t.timestamp.grow(n)),
+        symbol(t.symbol.grow(n)),
+        bid_size(t.bid_size.grow(n)),
+        bid_price(t.bid_price.grow(n)),
+        ask_price(t.ask_price.grow(n)),
+        ask_size(t.ask_size.grow(n)) {}
+
+  Byte* flags;
+  Timestamp* timestamp;
+  Symbol* symbol;
+  Integer* bid_size;
+  double* bid_price;
+  double* ask_price;
+  Integer* ask_size;
+};
+
+void decode_trades(const std::byte* const* messages, std::size_t n, const TradeRows& rows) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto* m = messages[i];
+    rows.flags[i] = field<Byte>(m, FLAGS);
+    rows.timestamp[i] = field<Timestamp>(m, TIMESTAMP);
+    rows.symbol[i] = field<Symbol>(m, SYMBOL);
+    rows.size[i] = field<Integer>(m, SIZE);
+    rows.price[i] = price_to_double(field<Price>(m, PRICE));
+    rows.trade_id[i] = field<Long>(m, TRADE_ID);
+  }
+}
+
+void decode_quotes(const std::byte* const* messages, std::size_t n, const QuoteRows& rows) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto* m = messages[i];
+    rows.flags[i] = field<Byte>(m, FLAGS);
+    rows.timestamp[i] = field<Timestamp>(m, TIMESTAMP);
+    rows.symbol[i] = field<Symbol>(m, SYMBOL);
+    rows.bid_size[i] = field<Integer>(m, BID_SIZE);
+    rows.bid_price[i] = price_to_double(field<Price>(m, BID_PRICE));
+    rows.ask_price[i] = price_to_double(field<Price>(m, ASK_PRICE));
+    rows.ask_size[i] = field<Integer>(m, ASK_SIZE);
+  }
+}
+
+}  // namespace
+
+bool ColumnFilter::accepts(Timestamp timestamp, const Symbol& symbol) const {
+  if (timestamp < begin || timestamp >= end) {
+    return false;
+  }
+  return symbols.empty() || std::find(symbols.cbegin(), symbols.cend(), symbol) != symbols.cend();
+}
+
+ColumnarCapture ColumnarCapture::decode(const std::string& file_path, const ColumnFilter& filter) {
+  ColumnarCapture capture;
+  ColumnDecoder decoder(capture, filter);
+
+  // read in chunks rather than through PcapReader, which keeps the whole file and a frame per block
+  std::ifstream is(file_path, std::ios::binary);
+  if (!is) {
+    capture_error("Cannot open " + file_path);
+  }
+  const auto chunk_size = std::min<std::size_t>(READ_CHUNK_SIZE, std::filesystem::file_size(file_path) + 1);
+  std::vector<std::byte> chunk;
+  std::size_t carry = 0;  // bytes of a block not complete in the previous chunk
+  std::pmr::monotonic_buffer_resource arena(1 << 20, &Memory::frames);
+  unsigned frame_number = 0;
+  MemoryHold chunk_memory(Memory::reader, 0);
+
+  while (is) {
+    // top the carried bytes up to a full chunk, so the buffer keeps its size
+    auto want = carry < chunk_size ? chunk_size - carry : chunk_size;
+    chunk.resize(carry + want);
+    chunk_memory.resize(chunk.capacity());
+    is.read(reinterpret_cast<char*>(chunk.data() + carry), static_cast<std::streamsize>(want));
+    auto size = carry + static_cast<std::size_t>(is.gcount());
+    auto complete = PcapReader::complete_blocks_size(chunk.data(), size);
+    chunk.resize(size);
+
+    auto end = chunk.cbegin() + static_cast<std::ptrdiff_t>(complete);
+    for (auto it = chunk.cbegin(); it != end;) {
+      auto frame = PcapReader::read_frame(it, frame_number++, &arena);
+      if (const auto* packet = frame.block_as<EnhancedPacketBlock>(); packet != nullptr) {
+        decoder.on_packet(packet->iex_tp);
+      }
+    }
+    // the collected messages point into the chunk
+    decoder.flush();
+    arena.release();
+
+    carry = size - complete;
+    std::copy(end, chunk.cend(), chunk.begin());
+  }
+
+  if (carry > 0) {
+    capture_error("length mismatch");
+  }
+
+  return capture;
+}
+
+ColumnarCapture ColumnarCapture::select(const ColumnFilter& filter) const {
+  ColumnarCapture selected;
+  std::size_t packet = 0;
+  std::size_t trade = 0;
+  std::size_t quote = 0;
+  std::size_t broken = 0;
+
+  auto copy_trade = [&filter, &selected](const TradeTable& from, std::size_t i, TradeTable& to, Byte type) {
+    if (!filter.accepts(from.timestamp[i], from.symbol[i])) {
+      return;
+    }
+    selected.events.push_back(type);
+    to.flags.push_back(from.flags[i]);
+    to.timestamp.push_back(from.timestamp[i]);
+    to.symbol.push_back(from.symbol[i]);
+    to.size.push_back(from.size[i]);
+    to.price.push_back(from.price[i]);
+    to.trade_id.push_back(from.trade_id[i]);
+  };
+
+  for (auto event : events) {
+    if (event == PACKET) {
+      selected.events.push_back(PACKET);
+      selected.packets.push_back(packets[packet++]);
+    } else if (event == TradeReportType) {
+      copy_trade(trades, trade++, selected.trades, TradeReportType);
+    } else if (event == TradeBreakType) {
+      copy_trade(breaks, broken++, selected.breaks, TradeBreakType);
+    } else {
+      auto i = quote++;
+      if (filter.accepts(quotes.timestamp[i], quotes.symbol[i])) {
+        auto& to = selected.quotes;
+        selected.events.push_back(QuoteUpdateType);
+        to.flags.push_back(quotes.flags[i]);
+        to.timestamp.push_back(quotes.timestamp[i]);
+        to.symbol.push_back(quotes.symbol[i]);
+        to.bid_size.push_back(quotes.bid_size[i]);
+        to.bid_price.push_back(quotes.bid_price[i]);
+        to.ask_price.push_back(quotes.ask_price[i]);
+        to.ask_size.push_back(quotes.ask_size[i]);
+      }
+    }
+  }
+
+  return selected;
+}
+
+ColumnDecoder::ColumnDecoder(ColumnarCapture& capture, const ColumnFilter& filter)
+    : capture(capture),
+      filter(filter),
+      filtering(!filter.symbols.empty() || filter.begin != ColumnFilter{}.begin || filter.end != ColumnFilter{}.end) {
+  trades.reserve(BATCH);
+  quotes.reserve(BATCH);
+}
+
+void ColumnDecoder::on_packet(const IexTpFrame& iex_tp) {
+  capture.events.push_back(ColumnarCapture::PACKET);
+  capture.packets.push_back(iex_tp.send_time);
+
+  iex_tp.for_each_message([this](Byte message_type, pcap_cit_t it) {
+    if (message_type != TradeReportType && message_type != QuoteUpdateType && message_type != TradeBreakType) {
+      return;
+    }
+
+    const auto* message = &*it;
+    if (filtering &&
+        !filter.accepts(field<Timestamp>(message, TIMESTAMP), field<Symbol>(message, SYMBOL))) {
+      return;
+    }
+
+    capture.events.push_back(message_type);
+    if (message_type == TradeReportType) {
+      trades.push_back(message);
+      if (trades.size() == BATCH) {
+        flush_trades();
+      }
+    } else if (message_type == QuoteUpdateType) {
+      quotes.push_back(message);
+      if (quotes.size() == BATCH) {
+        flush_quotes();
+      }
+    } else {
+      decode_trades(&message, 1, TradeRows(capture.breaks, 1));
+    }
+  });
+}
+
+void ColumnDecoder::flush() {
+  flush_trades();
+  flush_quotes();
+}
+
+void ColumnDecoder::flush_trades() {
+  decode_trades(trades.data(), trades.size(), TradeRows(capture.trades, trades.size()));
+  trades.clear();
+}
+
+void ColumnDecoder::flush_quotes() {
+  decode_quotes(quotes.data(), quotes.size(), QuoteRows(capture.quotes, quotes.size()));
+  quotes.clear();
+}
@@ -0,0 +1,89 @@
+#include <iextoolslib/book.hpp>
+#include <iextoolslib/conflate.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <sstream>
+
+using namespace IEXTools;
+
+// timer resolution, in ticks per interval
+static const std::size_t TICKS_PER_INTERVAL = 64;
+
+QuoteConflator::QuoteConflator(ConflationOptions options)
+    : options(options), timers(std::max<Timestamp>(options.interval, 1), TICKS_PER_INTERVAL) {}
+
+bool QuoteConflator::significant(const State& state, const Quote& quote) const {
+  if (!state.emitted || options.threshold == 0) {
+    return true;
+  }
+
+  const auto& last = state.last;
+  auto moved = [this](Price from, Price to) {
+    // a side that appears or disappears always counts
+    return (from == 0) != (to == 0) || (to > from ? to - from : from - to) > options.threshold;
+  };
+  return moved(last.bid_price, quote.bid_price) || moved(last.ask_price, quote.ask_price);
+}
+
+void QuoteConflator::on_quote(const QuoteUpdateMessage& message, Lines& lines) {
+  advance(message.timestamp, lines);
+
+  auto [it, inserted] = lookup.try_emplace(symbol_key(message.symbol), static_cast<uint32_t>(states.size()));
+  if (inserted) {
+    states.emplace_back().file = symbol_to_string(message.symbol) + SUFFIX;
+  }
+  auto& state = states[it->second];
+
+  Quote quote{message.timestamp, message.bid_size, message.bid_price, message.ask_price, message.ask_size};
+  auto is_significant = significant(state, quote);
+
+  if (is_significant && (options.interval == 0 || quote.timestamp >= state.next_allowed)) {
+    emit(state, quote, quote.timestamp, lines);
+    return;
+  }
+
+  state.held = quote;
+  state.holding = true;
+  state.held_significant |= is_significant;
+  if (is_significant && !state.scheduled) {
+    timers.schedule(state.next_allowed, it->second);
+    state.scheduled = true;
+  }
+}
+
+void QuoteConflator::advance(Timestamp now, Lines& lines) {
+  if (options.interval > 0) {
+    timers.advance(now, [this, &lines](uint32_t index) { fire(index, lines); });
+  }
+}
+
+void QuoteConflator::fire(uint32_t index, Lines& lines) {
+  auto& state = states[index];
+  state.scheduled = false;
+  if (state.holding && state.held_significant) {
+    // emitted when its interval ended, which also starts the next one
+    emit(state, state.held, state.next_allowed, lines);
+  }
+}
+
+void QuoteConflator::finish(Lines& lines) {
+  for (auto& state : states) {
+    if (state.holding) {
+      emit(state, state.held, state.held.timestamp, lines);
+    }
+    state.scheduled = false;
+  }
+  timers.drain([](uint32_t) {});
+}
+
+void QuoteConflator::emit(State& state, const Quote& quote, Timestamp at, Lines& lines) {
+  std::stringstream ss;
+  ss << quote.timestamp << "," << quote.bid_size << "," << price_to_double(quote.bid_price) << ","
+     << price_to_double(quote.ask_price) << "," << quote.ask_size;
+  lines.emplace_back(state.file, ss.str());
+
+  state.last = quote;
+  state.emitted = true;
+  state.holding = false;
+  state.held_significant = false;
+  state.next_allowed = at + options.interval;
+}
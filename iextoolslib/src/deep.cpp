@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <iextoolslib/deep.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <map>
+
+using namespace IEXTools;
+
+DeepReader::DeepReader(const std::string& file_path, const std::string& out_dir, std::size_t depth,
+                       OutputOptions output, bool verify_checksums)
+    : pcap(file_path), snapshots(depth), out_dir(out_dir), output(output) {
+  if (verify_checksums) {
+    verifier.emplace(out_dir);
+  }
+  parse_data();
+  dump_files();
+}
+
+void DeepSnapshots::on_packet(const IexTpFrame& iex_tp) {
+  if (iex_tp.message_protocol_id != DeepProtocol) {
+    return;
+  }
+
+  iex_tp.for_each_message([this](Byte message_type, pcap_cit_t it) {
+    if (message_type != PriceLevelUpdateBuyType && message_type != PriceLevelUpdateSellType) {
+      return;
+    }
+
+    auto update = PriceLevelUpdateMessage::read_from_block(it, message_type);
+    if (const auto* book = builder.apply(update)) {
+      auto& output = data[symbol_key(update.symbol)];
+      if (output.name.empty()) {
+        output.name = symbol_to_string(update.symbol);
+      }
+      format_snapshot(*book, output.lines);
+    }
+  });
+}
+
+void DeepSnapshots::format_snapshot(const PriceLevelBook& book, std::string& out) const {
+  out += std::to_string(book.last_update());
+
+  for (auto side : {Buy, Sell}) {
+    for (std::size_t i = 0; i < depth; ++i) {
+      out += ',';
+      if (i < book.depth(side)) {
+        const auto& level = book.level(side, i);
+        out += price_to_string(level.price);
+        out += ',';
+        out += std::to_string(level.size);
+      } else {
+        out += ',';
+      }
+    }
+  }
+  out += '\n';
+}
+
+void DeepReader::parse_data() {
+  for (auto& pcap_frame : pcap) {
+    if (const auto* enhanced_packet = pcap_frame.block_as<EnhancedPacketBlock>()) {
+      if (verifier && !verifier->verify(pcap_frame, *enhanced_packet)) {
+        continue;
+      }
+      snapshots.on_packet(enhanced_packet->iex_tp);
+    }
+  }
+
+  if (verifier) {
+    verifier->finish();
+  }
+}
+
+void DeepSnapshots::write(OutputWriter& writer) const {
+  std::map<std::string, const std::string*> sorted;
+  for (const auto& [key, output] : data) {
+    sorted.emplace(output.name, &output.lines);
+  }
+
+  for (const auto& [symbol, lines] : sorted) {
+    writer.append(symbol + ".book.csv", *lines);
+  }
+}
+
+void DeepReader::dump_files() const {
+  OutputWriter writer(out_dir, output);
+  snapshots.write(writer);
+  writer.finish();
+  writer.report();
+}
@@ -0,0 +1,34 @@
+#include <iextoolslib/deep_messages.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <iextoolslib/tops_messages.hpp>
+#include <sstream>
+
+using namespace IEXTools;
+
+PriceLevelUpdateMessage::PriceLevelUpdateMessage(Side side, Byte event_flags, Timestamp timestamp, Symbol symbol,
+                                                 Integer size, Price price)
+    : side(side), event_flags(event_flags), timestamp(timestamp), symbol(symbol), size(size), price(price) {}
+
+PriceLevelUpdateMessage PriceLevelUpdateMessage::read_from_block(pcap_cit_t it, Byte message_type) {
+  auto side = message_type == PriceLevelUpdateBuyType ? Buy : Sell;
+  auto event_flags = read_bytes<Byte>(it);
+  auto timestamp = read_bytes<Timestamp>(it);
+  auto symbol = read_bytes<Symbol>(it);
+  auto size = read_bytes<Integer>(it);
+  auto price = read_bytes<Price>(it);
+
+  return {side, event_flags, timestamp, symbol, size, price};
+}
+
+std::unique_ptr<PriceLevelUpdateMessage> PriceLevelUpdateMessage::from_raw_message(pcap_cit_t it, Byte message_type) {
+  return std::make_unique<PriceLevelUpdateMessage>(read_from_block(it, message_type));
+}
+
+std::string PriceLevelUpdateMessage::to_string() const {
+  std::stringstream ss;
+  ss << "PriceLevelUpdateMessage | timestamp=" << timestamp << " symbol=" << symbol
+     << " side=" << (side == Buy ? "buy" : "sell") << " price=$" << price_to_double(price) << " size=" << size
+     << (event_complete() ? "" : " (in transition)");
+
+  return ss.str();
+}
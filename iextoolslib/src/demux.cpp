@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <iextoolslib/demux.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <iostream>
+#include <iterator>
+
+using namespace IEXTools;
+
+static const std::size_t STREAM_BATCH_BYTES = 1 << 20;
+static const std::size_t STREAM_RING_CAPACITY = 8;
+static const std::size_t STREAM_FLUSH_BYTES = 64 << 10;  // per-symbol bytes buffered before appending to its file
+static const std::size_t DEFAULT_BOOK_DEPTH = 5;
+
+// The `count` messages of `iex_tp` starting at its message `skip`, as a packet of their own
+static IexTpFrame slice(const IexTpFrame& iex_tp, Long skip, Long count) {
+  if (skip == 0 && count == iex_tp.message_count) {
+    return iex_tp;
+  }
+
+  auto message_end = [&iex_tp](std::size_t offset) {
+    auto it = iex_tp.data_it + static_cast<std::ptrdiff_t>(offset);
+    return offset + sizeof(Short) + read_bytes<Short>(it);
+  };
+  std::size_t begin = 0;
+  for (Long i = 0; i < skip; ++i) {
+    begin = message_end(begin);
+  }
+  auto end = begin;
+  for (Long i = 0; i < count; ++i) {
+    end = message_end(end);
+  }
+
+  return {iex_tp.version,
+          iex_tp.message_protocol_id,
+          iex_tp.channel_id,
+          iex_tp.session_id,
+          static_cast<Short>(end - begin),
+          static_cast<Short>(count),
+          iex_tp.stream_offset + static_cast<Long>(begin),
+          iex_tp.first_message_sequence_number + skip,
+          iex_tp.send_time,
+          iex_tp.data_it + static_cast<std::ptrdiff_t>(begin)};
+}
+
+bool SequenceTracker::accept(const IexTpFrame& iex_tp, std::vector<IexTpFrame>& parts) {
+  parts.clear();
+  released.clear();
+  const auto first = iex_tp.first_message_sequence_number;
+  const auto end = first + iex_tp.message_count;
+
+  if (iex_tp.message_count == 0) {
+    parts.push_back(iex_tp);  // heartbeat
+    return true;
+  }
+  if (next == 0) {
+    next = first;
+  }
+
+  // messages before `next` were released already, or belong to a gap declared lost
+  const auto old_end = std::min(end, next);
+  uint64_t too_late = 0;
+  auto gap = lost.upper_bound(first);
+  if (gap != lost.begin() && std::prev(gap)->second > first) {
+    --gap;
+  }
+  for (; gap != lost.end() && gap->first < old_end; ++gap) {
+    too_late += static_cast<uint64_t>(std::min(gap->second, old_end) - std::max(gap->first, first));
+  }
+  late += too_late;
+  if (end <= next) {
+    duplicates += too_late == 0 ? 1 : 0;
+    return false;
+  }
+
+  if (first > next) {
+    // past a gap, the whole segment is kept and trimmed once released
+    auto segment_begin = iex_tp.data_it - IexTpFrame::HEADER_LENGTH;
+    auto [it, inserted] = held.try_emplace(first);
+    if (!inserted && it->second.size() >= static_cast<std::size_t>(IexTpFrame::HEADER_LENGTH + iex_tp.payload_length)) {
+      ++duplicates;
+      return false;
+    }
+    it->second.assign(segment_begin, iex_tp.data_it + iex_tp.payload_length);
+    if (held.size() > WINDOW) {
+      declare_lost(held.begin()->first);
+      release(parts);
+    }
+    return !parts.empty();
+  }
+
+  if (!held.empty()) {
+    recovered += static_cast<uint64_t>(std::min(end, held.begin()->first) - next);
+  }
+  parts.push_back(slice(iex_tp, next - first, end - next));
+  next = end;
+  release(parts);
+  return true;
+}
+
+void SequenceTracker::finish(std::vector<IexTpFrame>& parts) {
+  parts.clear();
+  released.clear();
+  while (!held.empty()) {
+    declare_lost(held.begin()->first);
+    release(parts);
+  }
+}
+
+void SequenceTracker::release(std::vector<IexTpFrame>& parts) {
+  while (!held.empty() && held.begin()->first <= next) {
+    auto segment = std::move(held.begin()->second);
+    held.erase(held.begin());
+
+    auto it = segment.cbegin();
+    auto iex_tp = IexTpFrame::read_from_block(it);
+    const auto first = iex_tp.first_message_sequence_number;
+    const auto end = first + iex_tp.message_count;
+    if (end <= next) {
+      ++duplicates;
+      continue;
+    }
+    parts.push_back(slice(iex_tp, next - first, end - next));
+    next = end;
+    released.push_back(std::move(segment));
+  }
+}
+
+void SequenceTracker::declare_lost(Long end) {
+  ++gaps;
+  missing += static_cast<uint64_t>(end - next);
+  lost.emplace(next, end);
+  next = end;
+}
+
+StreamDemux::StreamDemux(const std::string& file_path, std::filesystem::path out_dir, TopsOptions options)
+    : file_path(file_path), out_dir(std::move(out_dir)), options(options) {}
+
+void StreamDemux::run() {
+  {
+    PcapReader pcap(file_path);
+    std::optional<PacketVerifier> verifier;
+    if (options.verify_checksums) {
+      verifier.emplace(out_dir);
+    }
+
+    for (auto& frame : pcap) {
+      const auto* packet = frame.block_as<EnhancedPacketBlock>();
+      if (packet == nullptr || (verifier && !verifier->verify(frame, *packet))) {
+        continue;
+      }
+
+      const auto& iex_tp = packet->iex_tp;
+      if (iex_tp.message_protocol_id != TopsProtocol && iex_tp.message_protocol_id != DeepProtocol) {
+        ++skipped[iex_tp.message_protocol_id];
+        continue;
+      }
+
+      auto& s = stream(iex_tp);
+      auto segment_begin = iex_tp.data_it - IexTpFrame::HEADER_LENGTH;
+      s.pending.offsets.push_back(s.pending.bytes.size());
+      s.pending.bytes.insert(s.pending.bytes.end(), segment_begin, iex_tp.data_it + iex_tp.payload_length);
+      if (s.pending.bytes.size() >= STREAM_BATCH_BYTES) {
+        push(s);
+      }
+    }
+
+    if (verifier) {
+      verifier->finish();
+    }
+  }
+
+  for (auto& [key, s] : streams) {
+    if (!s->pending.offsets.empty()) {
+      push(*s);
+    }
+    s->ring.close();
+  }
+  for (auto& [key, s] : streams) {
+    s->worker.join();
+    std::cout << s->files << " files written to " << stream_dir(key).string() << std::endl;
+  }
+
+  for (const auto& [key, s] : streams) {
+    const auto& seq = s->sequence;
+    std::cerr << "Stream " << stream_dir(key).filename().string() << ": " << s->packets << " packets, " << s->messages
+              << " messages, " << seq.recovered << " messages put back in order, " << seq.gaps << " gaps lost ("
+              << seq.missing << " messages, " << seq.late << " arriving too late), " << seq.duplicates
+              << " duplicate packets" << std::endl;
+  }
+  for (const auto& [protocol, packets] : skipped) {
+    std::cerr << "Skipped " << packets << " packets of unknown protocol 0x" << std::hex << protocol << std::dec
+              << std::endl;
+  }
+}
+
+StreamDemux::Stream& StreamDemux::stream(const IexTpFrame& iex_tp) {
+  Key key{iex_tp.message_protocol_id, iex_tp.channel_id, iex_tp.session_id};
+  auto& s = streams[key];
+  if (!s) {
+    s = std::make_unique<Stream>(key, STREAM_RING_CAPACITY);
+    auto decode = std::get<0>(key) == TopsProtocol ? &StreamDemux::decode_tops : &StreamDemux::decode_deep;
+    s->worker = std::thread(decode, this, std::ref(*s));
+  }
+  return *s;
+}
+
+void StreamDemux::push(Stream& stream) {
+  stream.ring.push(std::move(stream.pending));
+  stream.pending = {};
+}
+
+std::filesystem::path StreamDemux::stream_dir(const Key& key) const {
+  const auto& [protocol, channel, session] = key;
+  return out_dir / ((protocol == TopsProtocol ? "tops-" : "deep-") + std::to_string(channel) + "-" +
+                    std::to_string(session));
+}
+
+void StreamDemux::decode_tops(Stream& stream) {
+  std::optional<QuoteJoin> join;
+  std::optional<DailySummary> summary;
+  if (options.join_quotes) {
+    join.emplace();
+  }
+  if (options.summary) {
+    summary.emplace();
+  }
+  std::optional<QuoteConflator> conflator;
+  if (options.conflation.enabled()) {
+    conflator.emplace(options.conflation);
+  }
+
+  std::filesystem::create_directory(stream_dir(stream.key));
+  OutputWriter writer(stream_dir(stream.key), options.output);
+  std::map<std::string, std::string> buffers;
+  std::vector<std::pair<std::string, std::string>> lines;
+  auto buffer_lines = [&]() {
+    for (auto& [symbol, line] : lines) {
+      auto& buffer = buffers[symbol];
+      buffer += line;
+      buffer += '\n';
+      if (buffer.size() >= STREAM_FLUSH_BYTES) {
+        writer.append(symbol + ".csv", buffer);
+        buffer.clear();
+      }
+    }
+  };
+  auto decode = [&](const std::vector<IexTpFrame>& parts) {
+    for (const auto& part : parts) {
+      stream.messages += part.message_count;
+      lines.clear();
+      TopsReader::format_trades(part, lines, join ? &*join : nullptr, summary ? &*summary : nullptr,
+                                conflator ? &*conflator : nullptr);
+      buffer_lines();
+    }
+  };
+
+  std::vector<IexTpFrame> parts;
+  Batch batch;
+  while (stream.ring.pop(batch)) {
+    for (auto offset : batch.offsets) {
+      auto it = batch.bytes.cbegin() + static_cast<std::ptrdiff_t>(offset);
+      auto iex_tp = IexTpFrame::read_from_block(it);
+      ++stream.packets;
+      if (stream.sequence.accept(iex_tp, parts)) {
+        decode(parts);
+      }
+    }
+  }
+  stream.sequence.finish(parts);
+  decode(parts);
+
+  if (conflator) {
+    lines.clear();
+    conflator->finish(lines);
+    buffer_lines();
+  }
+
+  for (auto& [symbol, buffer] : buffers) {
+    writer.append(symbol + ".csv", buffer);
+  }
+  if (summary) {
+    summary->write(writer);
+  }
+  writer.finish();
+  stream.files = writer.file_count();
+}
+
+void StreamDemux::decode_deep(Stream& stream) {
+  DeepSnapshots snapshots(options.book_depth > 0 ? options.book_depth : DEFAULT_BOOK_DEPTH);
+  auto decode = [&](const std::vector<IexTpFrame>& parts) {
+    for (const auto& part : parts) {
+      stream.messages += part.message_count;
+      snapshots.on_packet(part);
+    }
+  };
+
+  std::vector<IexTpFrame> parts;
+  Batch batch;
+  while (stream.ring.pop(batch)) {
+    for (auto offset : batch.offsets) {
+      auto it = batch.bytes.cbegin() + static_cast<std::ptrdiff_t>(offset);
+      auto iex_tp = IexTpFrame::read_from_block(it);
+      ++stream.packets;
+      if (stream.sequence.accept(iex_tp, parts)) {
+        decode(parts);
+      }
+    }
+  }
+  stream.sequence.finish(parts);
+  decode(parts);
+
+  std::filesystem::create_directory(stream_dir(stream.key));
+  OutputWriter writer(stream_dir(stream.key), options.output);
+  snapshots.write(writer);
+  writer.finish();
+  stream.files = writer.file_count();
+}
@@ -1,15 +1,66 @@
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <csignal>
 #include <filesystem>
 #include <functional>
+#include <iextoolslib/deep.hpp>
+#include <iextoolslib/demux.hpp>
 #include <iextoolslib/iextools.hpp>
+#include <iextoolslib/memory.hpp>
+#include <iextoolslib/output.hpp>
+#include <iextoolslib/pipeline.hpp>
 #include <iextoolslib/tops.hpp>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <tuple>
 #include <vector>
 
 void print_version();
 void print_help();
 
+// Whole number in `value`, at least `min`. Anything else throws std::invalid_argument, which main reports
+unsigned long parse_count(const std::string& value, unsigned long min = 0) {
+  unsigned long count = 0;
+  auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+  if (ec != std::errc{} || end != value.data() + value.size() || count < min) {
+    throw std::invalid_argument(value);
+  }
+  return count;
+}
+
+// Bytes in SIZE, a positive whole number that may end in K, M or G. Anything else throws std::invalid_argument
+std::size_t parse_size(const std::string& size) {
+  std::size_t bytes = 0;
+  auto [end, ec] = std::from_chars(size.data(), size.data() + size.size(), bytes);
+  if (ec != std::errc{} || bytes == 0 || size.data() + size.size() - end > 1) {
+    throw std::invalid_argument(size);
+  }
+
+  int shift = 0;
+  if (end != size.data() + size.size()) {
+    switch (std::toupper(*end)) {
+      case 'K':
+        shift = 10;
+        break;
+      case 'M':
+        shift = 20;
+        break;
+      case 'G':
+        shift = 30;
+        break;
+      default:
+        throw std::invalid_argument(size);
+    }
+  }
+  if (bytes > std::numeric_limits<std::size_t>::max() >> shift) {
+    throw std::invalid_argument(size);
+  }
+  return bytes << shift;
+}
+
 struct Opts {
   static Opts& instance() {
     static Opts _instance;
@@ -22,10 +73,102 @@ struct Opts {
  private:
   Opts()
       : opts({{"-h", "--help", "display this help and exit", print_help},
-              {"-v", "--version", "output version information and exit", print_version}}) {}
+              {"-v", "--version", "output version information and exit", print_version}}),
+        settings({{"-z", "--compress=CODEC[:LEVEL]", "compress the output files with gzip or zstd",
+                   [](IEXTools::TopsOptions& o, const std::string& v) {
+                     auto codec = v.substr(0, v.find(':'));
+                     if (codec == "gzip") {
+                       o.output.compression = IEXTools::Compression::Gzip;
+                     } else if (codec == "zstd" && IEXTools::OutputWriter::supports(IEXTools::Compression::Zstd)) {
+                       o.output.compression = IEXTools::Compression::Zstd;
+                     } else {
+                       std::cerr << "Unsupported compression '" << codec << "'.\n";
+                       std::exit(1);
+                     }
+                     if (v.find(':') != std::string::npos) {
+                       auto level_text = v.substr(v.find(':') + 1);
+                       int level = 0;
+                       auto [end, ec] =
+                           std::from_chars(level_text.data(), level_text.data() + level_text.size(), level);
+                       if (ec != std::errc{} || end != level_text.data() + level_text.size() ||
+                           !IEXTools::OutputWriter::supports(o.output.compression, level)) {
+                         throw std::invalid_argument(level_text);
+                       }
+                       o.output.level = level;
+                     }
+                   }},
+                  {"-p", "--pipeline", "overlap reading, decoding and writing on separate threads",
+                   [](IEXTools::TopsOptions& o, const std::string&) { o.pipelined = true; }},
+                  {"-f", "--follow[=SECONDS]", "keep decoding data appended to FILE, stop after SECONDS idle",
+                   [](IEXTools::TopsOptions& o, const std::string& v) {
+                     o.follow = true;
+                     o.follow_idle_timeout = v.empty() ? 0 : parse_count(v);
+                   }},
+                  {"-d", "--deep[=DEPTH]", "build DEEP price-level books, write DEPTH (5) levels per event",
+                   [](IEXTools::TopsOptions& o, const std::string& v) {
+                     o.book_depth = v.empty() ? 5 : parse_count(v, 1);
+                   }},
+                  {"-q", "--join-quotes", "append prevailing quote, trade side and effective spread to trades",
+                   [](IEXTools::TopsOptions& o, const std::string&) { o.join_quotes = true; }},
+                  {"-c", "--checkpoint[=SECONDS]", "record progress in OUT_DIR every SECONDS (5) to resume later",
+                   [](IEXTools::TopsOptions& o, const std::string& v) {
+                     o.checkpoint_interval = v.empty() ? 5 : parse_count(v, 1);
+                   }},
+                  {"-r", "--resume", "continue an interrupted run from the checkpoint in OUT_DIR",
+                   [](IEXTools::TopsOptions& o, const std::string&) { o.resume = true; }},
+                  {"-S", "--summary", "write per-symbol daily trade statistics to OUT_DIR/summary.csv",
+                   [](IEXTools::TopsOptions& o, const std::string&) { o.summary = true; }},
+                  {"-k", "--verify-checksums", "skip packets with bad IPv4/UDP checksums, keep them in OUT_DIR",
+                   [](IEXTools::TopsOptions& o, const std::string&) { o.verify_checksums = true; }},
+                  {"-m", "--demux", "decode each protocol, channel and session into its own OUT_DIR subdirectory",
+                   [](IEXTools::TopsOptions& o, const std::string&) { o.demux = true; }},
+                  {"-b", "--memory-budget=SIZE", "spill trades to sorted runs past SIZE bytes (K, M or G suffix)",
+                   [](IEXTools::TopsOptions& o, const std::string& v) { o.memory_budget = parse_size(v); }},
+                  {"-M", "--memory-limit=SIZE", "keep buffers within SIZE bytes, read the capture in chunks",
+                   [](IEXTools::TopsOptions& o, const std::string& v) { o.memory_limit = parse_size(v); }},
+                  {"-Q", "--conflate=INTERVAL", "write quotes to SYMBOL.quotes.csv, one per INTERVAL (ns, us, ms, s)",
+                   [](IEXTools::TopsOptions& o, const std::string& v) {
+                     auto unit_at = v.find_first_not_of("0123456789");
+                     auto count = parse_count(v.substr(0, unit_at), 1);
+                     auto unit = unit_at == std::string::npos ? std::string{} : v.substr(unit_at);
+                     unsigned long nanos = 0;
+                     if (unit == "s") {
+                       nanos = 1000000000;
+                     } else if (unit == "ms") {
+                       nanos = 1000000;
+                     } else if (unit == "us") {
+                       nanos = 1000;
+                     } else if (unit == "ns" || unit.empty()) {
+                       nanos = 1;
+                     } else {
+                       throw std::invalid_argument(unit);
+                     }
+                     if (count > static_cast<unsigned long>(std::numeric_limits<IEXTools::Timestamp>::max()) / nanos) {
+                       throw std::out_of_range(v);
+                     }
+                     o.conflation.interval = static_cast<IEXTools::Timestamp>(count * nanos);
+                   }},
+                  {"-T", "--conflate-move=PRICE", "write quotes to SYMBOL.quotes.csv once bid or ask moved over PRICE",
+                   [](IEXTools::TopsOptions& o, const std::string& v) {
+                     double dollars = 0;
+                     auto [end, ec] = std::from_chars(v.data(), v.data() + v.size(), dollars);
+                     // prices are 1/10000 dollar units in a 64 bit integer
+                     if (ec != std::errc{} || end != v.data() + v.size() || !(dollars >= 0) || dollars > 9e14) {
+                       throw std::invalid_argument(v);
+                     }
+                     o.conflation.threshold = std::llround(dollars * 10000);
+                   }},
+                  {"-C", "--cache=DIR", "reuse the capture decoded by an earlier run, kept in DIR",
+                   [](IEXTools::TopsOptions& o, const std::string& v) { o.cache_dir = v; }},
+                  {"-s", "--shards=N", "process symbols on N worker threads, one decoding thread routes them",
+                   [](IEXTools::TopsOptions& o, const std::string& v) { o.shards = parse_count(v, 1); }}}) {}
 
  public:
   std::vector<std::tuple<std::string, std::string, std::string, std::function<void(void)>>> opts;
+  // flags changing how the capture is processed, `--flag=VALUE` passes a value to them
+  std::vector<std::tuple<std::string, std::string, std::string,
+                         std::function<void(IEXTools::TopsOptions&, const std::string&)>>>
+      settings;
 };
 
 void print_version() {
@@ -36,7 +179,7 @@ void print_version() {
 void print_help() {
   using namespace std;
 
-  cout << "Usage: iex-tools [FILE] [OUT_DIR]\n";
+  cout << "Usage: iex-tools [OPTION]... [FILE] [OUT_DIR]\n";
   cout << "Parses a pcap-ng dump file containing IEX TOPS data.\n\n";
 
   auto opts = Opts::instance().opts;
@@ -46,40 +189,144 @@ void print_help() {
     cout << setfill(' ') << setw(5) << right << short_flag << " " << setw(24) << left << flag << "  " << description
          << "\n";
   }
+  for (const auto& setting : Opts::instance().settings) {
+    const auto& [short_flag, flag, description, func] = setting;
+    cout << setfill(' ') << setw(5) << right << short_flag << " " << setw(24) << left << flag << "  " << description
+         << "\n";
+  }
 }
 
 int main(int argc, char* argv[]) {
-  if (argc == 3) {
-    std::string arg1{argv[1]};
-    std::string arg2{argv[2]};
-
-    auto opts = Opts::instance().opts;
-    if (arg1.starts_with("-")) {
-      for (const auto& opt : opts) {
-        const auto& [short_flag, flag, description, func] = opt;
-        if (arg1 == short_flag || arg1 == flag) {
-          func();
-          return 0;
+  IEXTools::TopsOptions options;
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{argv[i]};
+
+    if (!arg.starts_with("-")) {
+      // no flag, then it is interpret as a path
+      paths.push_back(arg);
+      continue;
+    }
+
+    auto eq = arg.find('=');
+    auto name = arg.substr(0, eq);
+    auto value = eq == std::string::npos ? std::string{} : arg.substr(eq + 1);
+    bool known = false;
+
+    for (const auto& [short_flag, flag, description, func] : Opts::instance().opts) {
+      if (name == short_flag || name == flag) {
+        func();
+        return 0;
+      }
+    }
+    for (const auto& [short_flag, flag, description, func] : Opts::instance().settings) {
+      if (name == short_flag || name == flag.substr(0, flag.find_first_of("[="))) {
+        try {
+          func(options, value);
+        } catch (const std::logic_error&) {
+          // std::invalid_argument or std::out_of_range from parsing the value
+          std::cerr << "Invalid value in option '" << arg << "'.\n";
+          print_help();
+          return 1;
         }
+        known = true;
       }
-    } else {
-      // no flag, then it is interpret as a path
-      if (std::filesystem::exists(arg1)) {
-        if (std::filesystem::exists(arg2) && std::filesystem::is_directory(arg2) && std::filesystem::is_empty(arg2)) {
-          IEXTools::TopsReader tops(arg1, arg2);
-          return 0;
+    }
+
+    if (!known) {
+      std::cerr << "Unknown option '" << arg << "'.\n";
+      print_help();
+      return 1;
+    }
+  }
+
+  if (options.summary && (options.checkpoint_interval > 0 || options.resume)) {
+    std::cerr << "--summary cannot be combined with checkpoints.\n";
+    return 1;
+  }
+
+  if (options.conflation.enabled() && (options.checkpoint_interval > 0 || options.resume || options.shards > 1)) {
+    std::cerr << "--conflate cannot be combined with checkpoints or shards.\n";
+    return 1;
+  }
+
+  if (options.demux && (options.pipelined || options.follow || options.checkpoint_interval > 0 || options.resume ||
+                        options.shards > 1)) {
+    std::cerr << "--demux runs its own threads and cannot be combined with pipelining, following, checkpoints or "
+                 "shards.\n";
+    return 1;
+  }
+
+  if (options.book_depth > 0 && !options.demux &&
+      (options.shards > 1 || options.pipelined || options.follow || options.summary || options.join_quotes ||
+       options.conflation.enabled() || options.checkpoint_interval > 0 || options.resume)) {
+    std::cerr << "--deep only supports --compress and --verify-checksums, or --demux to split the streams.\n";
+    return 1;
+  }
+
+  if (options.shards > 1 &&
+      (options.pipelined || options.follow || options.checkpoint_interval > 0 || options.resume)) {
+    std::cerr << "--shards cannot be combined with pipelining, following or checkpoints.\n";
+    return 1;
+  }
+
+  if (!options.cache_dir.empty() && (options.pipelined || options.follow || options.checkpoint_interval > 0 ||
+                                     options.resume || options.shards > 1 || options.demux ||
+                                     options.verify_checksums || options.book_depth > 0)) {
+    std::cerr << "--cache only applies to the default TOPS mode, optionally with --memory-budget.\n";
+    return 1;
+  }
+
+  if (options.memory_budget > 0 && (options.pipelined || options.follow || options.checkpoint_interval > 0 ||
+                                    options.resume || options.shards > 1 || options.demux || options.book_depth > 0)) {
+    std::cerr << "--memory-budget only applies to the default TOPS mode.\n";
+    return 1;
+  }
+
+  if (options.memory_limit > 0 && (options.shards > 1 || options.demux || options.book_depth > 0)) {
+    std::cerr << "--memory-limit cannot be combined with shards, demux or DEEP books, they load the whole capture.\n";
+    return 1;
+  }
+
+  if (options.memory_limit > 0 && (options.summary || options.verify_checksums || !options.cache_dir.empty())) {
+    std::cerr << "--memory-limit cannot be combined with --summary, --verify-checksums or --cache, they are not "
+                 "bounded by it.\n";
+    return 1;
+  }
+
+  if (paths.size() == 2) {
+    const auto& arg1 = paths[0];
+    const auto& arg2 = paths[1];
+
+    if (std::filesystem::exists(arg1)) {
+      if (std::filesystem::exists(arg2) && std::filesystem::is_directory(arg2) &&
+          (options.resume || std::filesystem::is_empty(arg2))) {
+        if (options.follow) {
+          // let Ctrl-C stop following and flush what has been decoded so far
+          std::signal(SIGINT, [](int) { IEXTools::TopsPipeline::request_stop(); });
+          std::signal(SIGTERM, [](int) { IEXTools::TopsPipeline::request_stop(); });
+        }
+        if (options.demux) {
+          IEXTools::StreamDemux(arg1, arg2, options).run();
+        } else if (options.book_depth > 0) {
+          IEXTools::DeepReader deep(arg1, arg2, options.book_depth, options.output, options.verify_checksums);
         } else {
-          std::cerr << "Out dir '" << arg2 << "' must be an valid empty directory.\n";
-          return 1;
+          IEXTools::TopsReader tops(arg1, arg2, options);
         }
+        IEXTools::Memory::report(std::cout);
+        return 0;
       } else {
-        std::cerr << "File '" << arg1 << "' does not exist.\n";
+        std::cerr << "Out dir '" << arg2 << "' must be an valid empty directory.\n";
         return 1;
       }
+    } else {
+      std::cerr << "File '" << arg1 << "' does not exist.\n";
+      return 1;
     }
   }
 
   print_help();
 
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,72 @@
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iextoolslib/memory.hpp>
+#include <iomanip>
+
+using namespace IEXTools;
+
+static const std::size_t MIN_READ_CHUNK = 64 << 10;
+static const std::size_t MAX_READ_CHUNK = 8 << 20;
+static const std::size_t PAGE_SIZE = 4 << 10;
+
+void MemoryAccount::charge(std::size_t bytes) {
+  auto now = current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  auto peak = highest.load(std::memory_order_relaxed);
+  while (now > peak && !highest.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+  }
+}
+
+void MemoryAccount::release(std::size_t bytes) { current.fetch_sub(bytes, std::memory_order_relaxed); }
+
+void* MemoryAccount::do_allocate(std::size_t bytes, std::size_t alignment) {
+  auto* p = upstream->allocate(bytes, alignment);
+  charge(bytes);
+  return p;
+}
+
+void MemoryAccount::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+  upstream->deallocate(p, bytes, alignment);
+  release(bytes);
+}
+
+MemoryHold& MemoryHold::operator=(MemoryHold&& other) noexcept {
+  if (this != &other) {
+    reset();
+    account = other.account;
+    bytes = other.bytes;
+    other.bytes = 0;
+  }
+  return *this;
+}
+
+void MemoryHold::resize(std::size_t size) {
+  if (account != nullptr) {
+    if (size > bytes) {
+      account->charge(size - bytes);
+    } else {
+      account->release(bytes - size);
+    }
+  }
+  bytes = size;
+}
+
+void Memory::report(std::ostream& os) {
+  auto mib = [](std::size_t bytes) { return static_cast<double>(bytes) / (1 << 20); };
+
+  os << std::fixed << std::setprecision(1) << "Peak memory:";
+  for (const auto* account : {&reader, &frames, &messages, &output}) {
+    os << (account == &reader ? " " : ", ") << account->name << ' ' << mib(account->peak()) << " MiB";
+  }
+  rusage usage{};
+  if (::getrusage(RUSAGE_SELF, &usage) == 0) {
+    // ru_maxrss is in KiB
+    os << "; " << mib(static_cast<std::size_t>(usage.ru_maxrss) << 10) << " MiB resident";
+  }
+  os << std::defaultfloat << std::endl;
+}
+
+MemoryLimits::MemoryLimits(std::size_t limit)
+    : read_chunk(std::clamp(limit / 8, MIN_READ_CHUNK, MAX_READ_CHUNK) / PAGE_SIZE * PAGE_SIZE),
+      messages(std::max<std::size_t>(limit / 2, 1)),
+      output(std::max<std::size_t>(limit / 4, 1)) {}
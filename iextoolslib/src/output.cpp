@@ -0,0 +1,409 @@
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <iextoolslib/memory.hpp>
+#include <iextoolslib/output.hpp>
+#include <iostream>
+
+#ifdef IEXTOOLS_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace IEXTools;
+
+static const std::size_t COMPRESSION_BLOCK_SIZE = 4 << 20;
+static const std::size_t MIN_COMPRESSION_BLOCK_SIZE = 64 << 10;
+static const std::size_t FILE_BUFFER_SIZE = 256 << 10;  // buffered per file before it is written
+static const std::size_t TOTAL_BUFFER_SIZE = 64 << 20;  // buffered over all files before every file is written
+// a limited buffer is shared by at least this many files before they are written one by one
+static const std::size_t FILES_PER_BUFFER = 16;
+static const std::size_t CHUNK_SIZE = 16 << 10;         // small appends are copied together up to this size
+
+static std::size_t default_max_open() {
+  rlimit limit{};
+  if (::getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) {
+    return 512;
+  }
+  // leave room for the capture, sockets and whatever else the process opens
+  return std::clamp<std::size_t>(limit.rlim_cur / 2, 8, 4096);
+}
+
+OutputWriter::OutputWriter(std::filesystem::path out_dir, OutputOptions options)
+    : out_dir(std::move(out_dir)),
+      options(options),
+      total_buffer_size(options.buffer_limit > 0 ? options.buffer_limit : TOTAL_BUFFER_SIZE),
+      file_buffer_size(std::clamp(total_buffer_size / FILES_PER_BUFFER, CHUNK_SIZE, FILE_BUFFER_SIZE)),
+      block_size(std::clamp(total_buffer_size / FILES_PER_BUFFER, MIN_COMPRESSION_BLOCK_SIZE, COMPRESSION_BLOCK_SIZE)),
+      max_open(options.max_open > 0 ? options.max_open : default_max_open()) {
+  if (!supports(options.compression)) {
+    std::cerr << "zstd support was not enabled at build time" << std::endl;
+    std::exit(1);
+  }
+
+  if (options.compression != Compression::None) {
+    auto threads = options.threads > 0 ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned i = 0; i < threads; ++i) {
+      workers.emplace_back(&OutputWriter::work, this);
+    }
+  }
+}
+
+OutputWriter::~OutputWriter() { finish(); }
+
+bool OutputWriter::supports(Compression compression) {
+#ifdef IEXTOOLS_WITH_ZSTD
+  return true;
+#else
+  return compression != Compression::Zstd;
+#endif
+}
+
+bool OutputWriter::supports(Compression compression, int level) {
+  switch (compression) {
+    case Compression::Gzip:
+      return level >= Z_NO_COMPRESSION && level <= Z_BEST_COMPRESSION;
+#ifdef IEXTOOLS_WITH_ZSTD
+    case Compression::Zstd:
+      return level >= ZSTD_minCLevel() && level <= ZSTD_maxCLevel();
+#endif
+    default:
+      return false;
+  }
+}
+
+std::filesystem::path OutputWriter::path(const std::string& file_name) const {
+  switch (options.compression) {
+    case Compression::Gzip:
+      return out_dir / (file_name + ".gz");
+    case Compression::Zstd:
+      return out_dir / (file_name + ".zst");
+    case Compression::None:
+    default:
+      return out_dir / file_name;
+  }
+}
+
+OutputWriter::File& OutputWriter::file(const std::string& file_name) {
+  std::lock_guard lock(files_mutex);
+
+  auto& f = files[file_name];
+  if (!f) {
+    f = std::make_unique<File>();
+    f->path = path(file_name);
+  }
+  return *f;
+}
+
+void OutputWriter::append(const std::string& file_name, std::string_view data) {
+  auto& f = file(file_name);
+
+  if (options.compression == Compression::None) {
+    buffer(f, data);
+    if (buffered.load(std::memory_order_relaxed) >= total_buffer_size) {
+      flush();
+    }
+    return;
+  }
+
+  {
+    std::lock_guard lock(f.mutex);
+    f.staging.append(data);
+    hold(data.size());
+    while (f.staging.size() >= block_size) {
+      submit(f, f.staging.substr(0, block_size));
+      f.staging.erase(0, block_size);
+    }
+  }
+  if (buffered.load(std::memory_order_relaxed) >= total_buffer_size) {
+    // staged and submitted data stay counted until written, submit the staging of every file and wait for it
+    flush();
+    wait_idle();
+  }
+}
+
+void OutputWriter::hold(std::size_t bytes) {
+  buffered.fetch_add(bytes, std::memory_order_relaxed);
+  Memory::output.charge(bytes);
+}
+
+void OutputWriter::drop(std::size_t bytes) {
+  buffered.fetch_sub(bytes, std::memory_order_relaxed);
+  Memory::output.release(bytes);
+}
+
+void OutputWriter::buffer(File& f, std::string_view data) {
+  std::lock_guard lock(f.mutex);
+
+  if (data.size() < CHUNK_SIZE && !f.buffers.empty() && f.buffers.back().size() + data.size() <= CHUNK_SIZE) {
+    f.buffers.back().append(data);
+  } else {
+    f.buffers.emplace_back(data).reserve(std::max(data.size(), CHUNK_SIZE));
+  }
+  f.buffered += data.size();
+  hold(data.size());
+
+  if (f.buffered >= file_buffer_size) {
+    write_buffers(f);
+  }
+}
+
+void OutputWriter::write_buffers(File& f) {
+  if (f.buffers.empty()) {
+    return;
+  }
+  write(f, f.buffers);
+  drop(f.buffered);
+  f.buffers.clear();
+  f.buffered = 0;
+}
+
+void OutputWriter::submit(File& f, std::string data) {
+  {
+    std::lock_guard lock(jobs_mutex);
+    jobs.push_back({&f, f.next_block++, std::move(data)});
+  }
+  jobs_cv.notify_one();
+}
+
+void OutputWriter::flush() {
+  std::lock_guard lock(files_mutex);
+
+  for (auto& [name, f] : files) {
+    if (options.compression == Compression::None) {
+      std::lock_guard file_lock(f->mutex);
+      write_buffers(*f);
+    } else {
+      std::lock_guard file_lock(f->mutex);
+      if (!f->staging.empty()) {
+        submit(*f, std::move(f->staging));
+        f->staging.clear();
+      }
+    }
+  }
+}
+
+void IEXTools::sync_path(const std::filesystem::path& path) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0 || ::fsync(fd) != 0) {
+    std::cerr << "Cannot sync " << path << ": " << std::strerror(errno) << std::endl;
+    std::exit(1);
+  }
+  ::close(fd);
+}
+
+void OutputWriter::sync() {
+  flush();
+  wait_idle();
+
+  // closed files were evicted from the pool after their last write and are reopened to be synced
+  std::scoped_lock lock(files_mutex, pool_mutex);
+  bool any = false;
+  for (auto& [name, f] : files) {
+    if (!f->unsynced) {
+      continue;
+    }
+    if (f->fd < 0) {
+      sync_path(f->path);
+    } else if (::fsync(f->fd) != 0) {
+      std::cerr << "Cannot sync " << f->path << ": " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+    f->unsynced = false;
+    any = true;
+  }
+  // new files only survive a crash once their directory entry is synced too
+  if (any) {
+    sync_path(out_dir);
+  }
+}
+
+void OutputWriter::wait_idle() {
+  if (workers.empty()) {
+    return;
+  }
+
+  std::unique_lock lock(jobs_mutex);
+  idle_cv.wait(lock, [this] { return jobs.empty() && in_flight == 0; });
+}
+
+void OutputWriter::finish() {
+  flush();
+  wait_idle();
+
+  if (!workers.empty()) {
+    {
+      std::lock_guard lock(jobs_mutex);
+      stopping = true;
+    }
+    jobs_cv.notify_all();
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+  }
+
+  close_all();
+}
+
+void OutputWriter::work() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock lock(jobs_mutex);
+      jobs_cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+      if (jobs.empty()) {
+        return;
+      }
+      job = std::move(jobs.front());
+      jobs.pop_front();
+      ++in_flight;
+    }
+
+    auto compressed = compress(job.data);
+    auto uncompressed = job.data.size();
+    {
+      // blocks of a file may finish out of order, append every block that is next in sequence in one write
+      std::lock_guard lock(job.file->mutex);
+      auto& f = *job.file;
+      f.ready.emplace(job.block, std::move(compressed));
+      std::vector<std::string> in_order;
+      for (auto it = f.ready.begin(); it != f.ready.end() && it->first == f.next_write; it = f.ready.erase(it)) {
+        in_order.push_back(std::move(it->second));
+        ++f.next_write;
+      }
+      write(f, in_order);
+    }
+    drop(uncompressed);
+
+    {
+      std::lock_guard lock(jobs_mutex);
+      --in_flight;
+    }
+    idle_cv.notify_all();
+  }
+}
+
+std::string OutputWriter::compress(const std::string& data) const {
+  std::string out;
+
+  if (options.compression == Compression::Gzip) {
+    z_stream zs{};
+    // 16 added to the window bits asks zlib for a gzip header and trailer
+    if (deflateInit2(&zs, options.level.value_or(Z_DEFAULT_COMPRESSION), Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) !=
+        Z_OK) {
+      std::cerr << "deflateInit2 failed" << std::endl;
+      std::exit(1);
+    }
+    out.resize(deflateBound(&zs, data.size()));
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+    // the output is sized by deflateBound, so the whole input fits in one call
+    if (auto result = deflate(&zs, Z_FINISH); result != Z_STREAM_END) {
+      std::cerr << "deflate failed: " << result << std::endl;
+      std::exit(1);
+    }
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+  }
+#ifdef IEXTOOLS_WITH_ZSTD
+  else if (options.compression == Compression::Zstd) {
+    out.resize(ZSTD_compressBound(data.size()));
+    auto size = ZSTD_compress(out.data(), out.size(), data.data(), data.size(),
+                              options.level.value_or(ZSTD_CLEVEL_DEFAULT));
+    if (ZSTD_isError(size)) {
+      std::cerr << "ZSTD_compress failed: " << ZSTD_getErrorName(size) << std::endl;
+      std::exit(1);
+    }
+    out.resize(size);
+  }
+#endif
+
+  return out;
+}
+
+void OutputWriter::write(File& f, const std::vector<std::string>& chunks) {
+  // the file leaves the pool while it is written, so the write runs unlocked and the descriptor cannot be evicted
+  {
+    std::lock_guard lock(pool_mutex);
+    if (f.fd >= 0) {
+      open_files.erase(f.lru);
+    } else {
+      // descriptors being written are not in the pool, their writers may briefly take the count over max_open
+      if (open_count >= max_open && !open_files.empty()) {
+        auto* evicted = open_files.back();
+        ::close(evicted->fd);
+        evicted->fd = -1;
+        open_files.pop_back();
+        --open_count;
+      }
+      f.fd = ::open(f.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+      if (f.fd < 0) {
+        std::cerr << "Cannot open " << f.path << ": " << std::strerror(errno) << std::endl;
+        std::exit(1);
+      }
+      ++open_count;
+    }
+    f.unsynced = true;
+  }
+
+  std::vector<iovec> iov;
+  for (const auto& chunk : chunks) {
+    if (!chunk.empty()) {
+      iov.push_back({const_cast<char*>(chunk.data()), chunk.size()});
+    }
+  }
+
+  for (std::size_t i = 0; i < iov.size();) {
+    auto n = ::writev(f.fd, &iov[i], static_cast<int>(std::min<std::size_t>(iov.size() - i, IOV_MAX)));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Error writing " << f.path << ": " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+    // skip what was written, a short write leaves the rest of a chunk for the next call
+    for (auto written = static_cast<std::size_t>(n); i < iov.size() && written > 0;) {
+      auto step = std::min(written, iov[i].iov_len);
+      iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + step;
+      iov[i].iov_len -= step;
+      written -= step;
+      if (iov[i].iov_len == 0) {
+        ++i;
+      }
+    }
+  }
+
+  std::lock_guard lock(pool_mutex);
+  open_files.push_front(&f);
+  f.lru = open_files.begin();
+}
+
+void OutputWriter::close_all() {
+  std::lock_guard lock(pool_mutex);
+  for (auto* f : open_files) {
+    ::close(f->fd);
+    f->fd = -1;
+  }
+  open_files.clear();
+  open_count = 0;
+}
+
+std::size_t OutputWriter::file_count() const {
+  std::lock_guard lock(files_mutex);
+  return files.size();
+}
+
+void OutputWriter::report() const {
+  std::cout << file_count() << " files written to " << out_dir.string() << std::endl;
+}
@@ -1,17 +1,25 @@
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iextoolslib/pcap.hpp>
 #include <iextoolslib/pcap_frames.hpp>
 #include <iextoolslib/pcap_utils.hpp>
 #include <iextoolslib/tops_messages.hpp>
 #include <iomanip>
-#include <iostream>
 #include <memory>
 
 using namespace IEXTools;
 
+static const std::size_t ARENA_BLOCK_SIZE = 1 << 20;
+
 PcapReader::PcapReader(const std::string& file_path)
-    : file_path(file_path), file_size(get_file_size(file_path)), data(load_data()), frames(get_frames()) {}
+    : file_path(file_path),
+      file_size(get_file_size(file_path)),
+      data(load_data()),
+      arena(ARENA_BLOCK_SIZE, &Memory::frames),
+      frames(get_frames()),
+      data_memory(Memory::reader, data.capacity()),
+      frames_memory(Memory::frames, frames.capacity() * sizeof(PcapFrame)) {}
 
 std::size_t PcapReader::get_file_size(const std::string& path) {
   std::ifstream is(path);
@@ -31,36 +39,59 @@ std::vector<std::byte> IEXTools::PcapReader::load_data() {
   return d;
 }
 
+std::size_t PcapReader::complete_blocks_size(const std::byte* data, std::size_t size) {
+  std::size_t pos = 0;
+
+  while (size - pos >= sizeof(uint32_t) * 2) {
+    uint32_t block_length;
+    std::memcpy(&block_length, data + pos + sizeof(uint32_t), sizeof(block_length));
+
+    if (block_length < sizeof(uint32_t) * 3) {
+      capture_error("length mismatch");
+    }
+    if (pos + block_length > size) {
+      break;
+    }
+    pos += block_length;
+  }
+
+  return pos;
+}
+
 std::vector<PcapFrame> PcapReader::get_frames() {
   auto it = data.cbegin();
   std::vector<PcapFrame> _frames;
 
   for (unsigned n = 0; it != data.cend(); ++n) {
-    pcap_cit_t begin_block_it{it};
-
-    auto block_type = read_bytes<uint32_t>(it);
-    auto block_length_begin_frame = read_bytes<uint32_t>(it);
-    auto it_begin{it};                                      // points to the first byte containing pcap data block
-    it += block_length_begin_frame - sizeof(uint32_t) * 3;  // skip to the end of the block
-    auto it_end{it};  // points to the next byte after the end of the pcap data block
-    auto block_length_end_frame = read_bytes<uint32_t>(it);
-
-    if (block_length_begin_frame != block_length_end_frame) {
-      std::cerr << "length mismatch" << std::endl;
-      std::exit(1);
-    }
-
-    _frames.emplace_back(block_type, n, block_length_begin_frame, begin_block_it,
-                         std::unique_ptr<PcapBlock>(get_block(block_type, it_begin, it_end)));
+    _frames.emplace_back(read_frame(it, n, &arena));
   }
 
   return _frames;
 }
 
-std::unique_ptr<PcapBlock> PcapReader::get_block(int block_type, pcap_cit_t it_begin, pcap_cit_t it_end) {
+PcapFrame PcapReader::read_frame(pcap_cit_t& it, unsigned frame_number, std::pmr::memory_resource* arena) {
+  pcap_cit_t begin_block_it{it};
+
+  auto block_type = read_bytes<uint32_t>(it);
+  auto block_length_begin_frame = read_bytes<uint32_t>(it);
+  auto it_begin{it};                                      // points to the first byte containing pcap data block
+  it += block_length_begin_frame - sizeof(uint32_t) * 3;  // skip to the end of the block
+  auto it_end{it};  // points to the next byte after the end of the pcap data block
+  auto block_length_end_frame = read_bytes<uint32_t>(it);
+
+  if (block_length_begin_frame != block_length_end_frame) {
+    capture_error("length mismatch");
+  }
+
+  return {static_cast<int>(block_type), frame_number, block_length_begin_frame, begin_block_it,
+          get_block(block_type, it_begin, it_end, arena)};
+}
+
+PcapBlock* PcapReader::get_block(int block_type, pcap_cit_t it_begin, pcap_cit_t it_end,
+                                 std::pmr::memory_resource* arena) {
   switch (block_type) {
     case PcapFrame::ENHANCED_PACKET_BLOCK_TYPE:
-      return get_enhanced_packet_block(it_begin, it_end);
+      return get_enhanced_packet_block(it_begin, it_end, arena);
     // TODO: implement the rest of swith cases
     case PcapFrame::HEADER_BLOCK_TYPE:
     case PcapFrame::INTERFACE_DESCRIPTION_BLOCK_TYPE:
@@ -75,7 +106,8 @@ std::unique_ptr<PcapBlock> PcapReader::get_block(int block_type, pcap_cit_t it_b
   }
 }
 
-std::unique_ptr<EnhancedPacketBlock> PcapReader::get_enhanced_packet_block(pcap_cit_t it_begin, pcap_cit_t it_end) {
+EnhancedPacketBlock* PcapReader::get_enhanced_packet_block(pcap_cit_t it_begin, pcap_cit_t it_end,
+                                                           std::pmr::memory_resource* arena) {
   auto interface_id = read_bytes<uint32_t>(it_begin);
   uint64_t timestamp_high = read_bytes<uint32_t>(it_begin);
   timestamp_high = timestamp_high << 32;
@@ -89,8 +121,7 @@ std::unique_ptr<EnhancedPacketBlock> PcapReader::get_enhanced_packet_block(pcap_
 
   if (ip.protocol != IP_FRAME_TRANSPORT_PROTOCOL_UDP) {
     // TODO: manage TCP connections?
-    std::cerr << "Transport protocol is (" << ip.protocol << "). Only UPD (17) is supported.";
-    std::exit(1);
+    capture_error("Transport protocol is (" + std::to_string(ip.protocol) + "). Only UPD (17) is supported.");
   }
 
   auto transport = UDPFrame::read_from_block(it_begin);
@@ -98,12 +129,12 @@ std::unique_ptr<EnhancedPacketBlock> PcapReader::get_enhanced_packet_block(pcap_
 
   if (it_begin >= it_end) {
     // TODO: manage situation
-    std::cerr << "Read out of boundaries" << std::endl;
-    std::exit(1);
+    capture_error("Read out of boundaries");
   }
 
-  return std::make_unique<EnhancedPacketBlock>(it_begin, it_end, interface_id, timestamp, captured_packet_length,
-                                               original_packet_length, ethernet, ip, transport, iex);
+  return std::pmr::polymorphic_allocator<>(arena).new_object<EnhancedPacketBlock>(
+      it_begin, it_end, interface_id, timestamp, captured_packet_length, original_packet_length, ethernet, ip,
+      transport, iex);
 }
 
 std::ostream& operator<<(std::ostream& os, const IEXTools::PcapFrame& obj) {
@@ -1,6 +1,5 @@
 #include <iextoolslib/pcap_frames.hpp>
 #include <iextoolslib/pcap_utils.hpp>
-#include <iostream>
 #include <utility>
 
 using namespace IEXTools;
@@ -55,9 +54,8 @@ IPv4Frame IPv4Frame::read_from_block(pcap_cit_t& it) {
   auto dst_addr = read_bytes<uint32_t>(it);
 
   if (ihl > 5) {
-    std::cerr << "IHL=" << ihl << ", IPv4 Options not implemented, from this point onwards behaviour is not guaranteed"
-              << std::endl;
-    std::exit(1);
+    capture_error("IHL=" + std::to_string(ihl) +
+                  ", IPv4 Options not implemented, from this point onwards behaviour is not guaranteed");
   }
 
   return IPv4Frame(version, ihl, dscp, ecn, total_length, identification, flags, ttl, protocol, header_checksum,
@@ -125,16 +123,15 @@ EnhancedPacketBlock::EnhancedPacketBlock(pcap_cit_t begin, pcap_cit_t end, uint3
       udp(udp),
       iex_tp(std::move(iex_tps)) {}
 
-PcapFrame::PcapFrame(int type, unsigned frame_number, size_t frame_length, pcap_cit_t iterator,
-                     std::unique_ptr<PcapBlock> block)
+PcapFrame::PcapFrame(int type, unsigned frame_number, size_t frame_length, pcap_cit_t iterator, PcapBlock* block)
     : type(type),
       type_name(get_frame_type_name(type)),
       frame_number(frame_number),
       frame_length(frame_length),
       iterator(iterator),
-      block(std::move(block)) {}
+      block(block) {}
 
-std::string PcapFrame::get_frame_type_name(int type) {
+std::string_view PcapFrame::get_frame_type_name(int type) {
   switch (type) {
     case 0x0A0D0D0A:
       return "Header Block";
@@ -1,12 +1,26 @@
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <iextoolslib/pcap_utils.hpp>
 #include <iomanip>
+#include <iostream>
 #include <regex>
 #include <sstream>
 
 using namespace IEXTools;
 
+static std::atomic<bool> throwing_capture_errors{false};
+
+void IEXTools::capture_error(const std::string& message) {
+  if (throwing_capture_errors.load()) {
+    throw CaptureError(message);
+  }
+  std::cerr << message << std::endl;
+  std::exit(1);
+}
+
+void IEXTools::throw_capture_errors() { throwing_capture_errors.store(true); }
+
 std::string IEXTools::symbol_to_string(Symbol symbol) {
   return std::string(symbol.begin(), std::find(symbol.begin(), symbol.end(), ' '));
 }
@@ -31,4 +45,20 @@ std::string IEXTools::ip_addr_formatter(uint32_t addr) {
   return ss.str();
 }
 
-double IEXTools::price_to_double(Price price) { return price * 1e-4; }
\ No newline at end of file
+double IEXTools::price_to_double(Price price) { return price * 1e-4; }
+
+std::string IEXTools::price_to_string(Price price) {
+  // negated as unsigned so that the lowest price does not overflow
+  auto magnitude = static_cast<uint64_t>(price);
+  auto s = std::to_string(price < 0 ? 0 - magnitude : magnitude);
+  if (s.size() < 5) {
+    s.insert(0, 5 - s.size(), '0');
+  }
+  s.insert(s.size() - 4, ".");
+  s.erase(s.find_last_not_of('0') + 1);
+  if (s.back() == '.') {
+    s.pop_back();
+  }
+
+  return price < 0 ? "-" + s : s;
+}
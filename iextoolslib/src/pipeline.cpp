@@ -0,0 +1,351 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <iextoolslib/pcap.hpp>
+#include <iextoolslib/pipeline.hpp>
+#include <iextoolslib/tops.hpp>
+#include <iostream>
+#include <memory_resource>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <thread>
+
+using namespace IEXTools;
+
+TopsPipeline::TopsPipeline(std::string file_path, std::filesystem::path out_dir)
+    : TopsPipeline(std::move(file_path), std::move(out_dir), Options{}) {}
+
+TopsPipeline::TopsPipeline(std::string file_path, std::filesystem::path out_dir, Options options)
+    : file_path(std::move(file_path)),
+      out_dir(std::move(out_dir)),
+      options(options),
+      chunks(options.ring_capacity),
+      batches(options.ring_capacity) {}
+
+void TopsPipeline::run() {
+  if (options.resume) {
+    prepare_resume();
+  }
+
+  std::thread reader(&TopsPipeline::read_stage, this);
+  std::thread decoder(&TopsPipeline::decode_stage, this);
+  std::thread writer(&TopsPipeline::output_stage, this);
+
+  reader.join();
+  decoder.join();
+  writer.join();
+
+  if ((options.checkpoint_interval > 0 || options.resume) && !stop_requested.load()) {
+    Checkpoint::remove(out_dir);
+  }
+}
+
+// Whether `path` is named like the output of a symbol, or the breaks, as `writer` names them
+static bool is_symbol_file(const OutputWriter& writer, const std::filesystem::path& path) {
+  auto name = path.filename().string();
+  auto suffix = writer.path(".csv").filename().string();
+  if (name.size() <= suffix.size() || !name.ends_with(suffix)) {
+    return false;
+  }
+  auto stem = name.substr(0, name.size() - suffix.size());
+  return stem == TopsReader::BREAKS || std::all_of(stem.cbegin(), stem.cend(), [](char c) {
+           return std::isupper(static_cast<unsigned char>(c)) || std::isdigit(static_cast<unsigned char>(c)) ||
+                  std::strchr(".+-=^#*", c) != nullptr;
+         });
+}
+
+void TopsPipeline::prepare_resume() {
+  resume_from = Checkpoint::load(out_dir);
+  if (!resume_from) {
+    std::cerr << "No checkpoint to resume from in " << out_dir << std::endl;
+    std::exit(1);
+  }
+  if (resume_from->join_quotes != options.join_quotes || resume_from->compression != options.output.compression) {
+    std::cerr << "Options differ from the run that wrote the checkpoint" << std::endl;
+    std::exit(1);
+  }
+
+  // drop whatever was written after the checkpoint: the recorded files go back to their size, symbol files the
+  // checkpoint did not know yet are removed. Anything else in out_dir is left alone
+  OutputWriter writer(out_dir, options.output);
+  std::set<std::filesystem::path> recorded;
+  for (const auto& [symbol, size] : resume_from->files) {
+    auto path = writer.path(symbol + ".csv");
+    std::filesystem::resize_file(path, size);
+    recorded.insert(path);
+  }
+  for (const auto& entry : std::filesystem::directory_iterator(out_dir)) {
+    if (entry.is_regular_file() && !recorded.contains(entry.path()) && is_symbol_file(writer, entry.path())) {
+      std::filesystem::remove(entry.path());
+    }
+  }
+
+  std::cerr << "Resuming at offset " << resume_from->offset << " after message " << resume_from->last_sequence
+            << std::endl;
+}
+
+void TopsPipeline::save_checkpoint(const Batch& batch, const std::map<std::string, std::string>& buffers,
+                                   const OutputWriter& writer) const {
+  Checkpoint checkpoint;
+  checkpoint.offset = batch.end_offset;
+  checkpoint.last_sequence = batch.last_sequence;
+  checkpoint.join_quotes = options.join_quotes;
+  checkpoint.compression = options.output.compression;
+  checkpoint.state = *batch.state;
+
+  for (const auto& [symbol, buffer] : buffers) {
+    auto path = writer.path(symbol + ".csv");
+    checkpoint.files.emplace(symbol, std::filesystem::exists(path) ? std::filesystem::file_size(path) : 0);
+  }
+
+  checkpoint.save(out_dir);
+}
+
+void TopsPipeline::read_stage() {
+  int fd = ::open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Cannot open '" << file_path << "': " << std::strerror(errno) << std::endl;
+    std::exit(1);
+  }
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  int watch_fd = -1;
+  if (options.follow) {
+    watch_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_fd < 0 || ::inotify_add_watch(watch_fd, file_path.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+      std::cerr << "Cannot watch '" << file_path << "': " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+  }
+
+  Bytes carry;  // trailing bytes of a block that did not fit in the previous read
+  off_t offset = resume_from ? resume_from->offset : 0;
+
+  for (;;) {
+    if (stop_requested.load()) {
+      break;
+    }
+    auto want = options.read_size;
+    if (options.follow) {
+      auto available = wait_for_data(fd, offset, watch_fd);
+      if (available == 0) {
+        break;
+      }
+      want = std::min(want, available);
+    }
+
+    // ask the kernel to start fetching the next read while this one is being split and decoded
+    ::posix_fadvise(fd, offset + static_cast<off_t>(want), static_cast<off_t>(options.read_size), POSIX_FADV_WILLNEED);
+
+    Bytes chunk(carry.size() + want);
+    std::copy(carry.cbegin(), carry.cend(), chunk.begin());
+
+    std::size_t read = 0;
+    while (read < want) {
+      auto n = ::pread(fd, chunk.data() + carry.size() + read, want - read, offset);
+      if (n < 0) {
+        std::cerr << "Error reading '" << file_path << "': " << std::strerror(errno) << std::endl;
+        std::exit(1);
+      }
+      if (n == 0) {
+        break;
+      }
+      read += n;
+      offset += n;
+    }
+
+    auto size = carry.size() + read;
+    auto complete = PcapReader::complete_blocks_size(chunk.data(), size);
+    carry.assign(chunk.cbegin() + static_cast<std::ptrdiff_t>(complete),
+                 chunk.cbegin() + static_cast<std::ptrdiff_t>(size));
+    chunk.resize(complete);
+
+    if (!chunk.empty()) {
+      MemoryHold memory(Memory::reader, chunk.capacity());
+      chunks.push({std::move(chunk), offset - static_cast<off_t>(carry.size()), std::move(memory)});
+    }
+    if (!options.follow && read < want) {
+      break;
+    }
+  }
+  ::close(fd);
+  if (watch_fd >= 0) {
+    ::close(watch_fd);
+  }
+
+  if (!carry.empty()) {
+    if (!options.follow) {
+      std::cerr << "length mismatch" << std::endl;
+      std::exit(1);
+    }
+    std::cerr << "Ignoring incomplete trailing block (" << carry.size() << " bytes)" << std::endl;
+  }
+  chunks.close();
+}
+
+std::size_t TopsPipeline::wait_for_data(int fd, off_t offset, int watch_fd) const {
+  using clock = std::chrono::steady_clock;
+  auto idle_since = clock::now();
+
+  for (;;) {
+    // checked first, a capture that keeps growing must not keep a stop request waiting
+    if (stop_requested.load()) {
+      return 0;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_size > offset) {
+      return static_cast<std::size_t>(st.st_size - offset);
+    }
+    if (options.idle_timeout > 0 && clock::now() - idle_since >= std::chrono::seconds(options.idle_timeout)) {
+      return 0;
+    }
+
+    // the timeout bounds how late a stop request or the idle timeout is noticed
+    pollfd pfd{watch_fd, POLLIN, 0};
+    if (::poll(&pfd, 1, 200) > 0) {
+      alignas(inotify_event) char events[4096];
+      while (::read(watch_fd, events, sizeof(events)) > 0) {
+      }
+    }
+  }
+}
+
+void TopsPipeline::decode_stage() {
+  unsigned frame_number = 0;
+  Chunk chunk;
+  std::pmr::monotonic_buffer_resource arena(1 << 20, &Memory::frames);
+  std::optional<QuoteJoin> join;
+  if (options.join_quotes) {
+    join.emplace();
+    if (resume_from) {
+      std::istringstream is(resume_from->state);
+      join->load(is);
+    }
+  }
+
+  if (options.summary) {
+    summary.emplace();
+  }
+
+  std::optional<PacketVerifier> verifier;
+  if (options.verify_checksums) {
+    verifier.emplace(out_dir);
+  }
+
+  std::optional<QuoteConflator> conflator;
+  if (options.conflation.enabled()) {
+    conflator.emplace(options.conflation);
+  }
+
+  using clock = std::chrono::steady_clock;
+  auto last_checkpoint = clock::now();
+  Long last_sequence = resume_from ? resume_from->last_sequence : 0;
+
+  while (chunks.pop(chunk)) {
+    Batch batch;
+
+    for (auto it = chunk.data.cbegin(); it != chunk.data.cend();) {
+      auto frame = PcapReader::read_frame(it, frame_number++, &arena);
+      if (const auto* enhanced_packet = frame.block_as<EnhancedPacketBlock>()) {
+        if (verifier && !verifier->verify(frame, *enhanced_packet)) {
+          continue;
+        }
+        TopsReader::format_trades(*enhanced_packet, batch.lines, join ? &*join : nullptr,
+                                  summary ? &*summary : nullptr, conflator ? &*conflator : nullptr);
+
+        const auto& iex = enhanced_packet->iex_tp;
+        if (iex.message_count > 0) {
+          last_sequence = iex.first_message_sequence_number + iex.message_count - 1;
+        }
+      }
+    }
+    batch.end_offset = chunk.end_offset;
+    batch.last_sequence = last_sequence;
+
+    if (options.checkpoint_interval > 0 &&
+        clock::now() - last_checkpoint >= std::chrono::seconds(options.checkpoint_interval)) {
+      std::ostringstream os;
+      if (join) {
+        join->save(os);
+      }
+      batch.state = os.str();
+      last_checkpoint = clock::now();
+    }
+
+    batches.push(std::move(batch));
+    arena.release();  // the blocks of this chunk are no longer referenced
+  }
+
+  if (conflator) {
+    Batch batch;
+    conflator->finish(batch.lines);
+    batch.last_sequence = last_sequence;
+    batches.push(std::move(batch));
+  }
+  batches.close();
+
+  if (verifier) {
+    verifier->finish();
+  }
+}
+
+void TopsPipeline::output_stage() {
+  std::map<std::string, std::string> buffers;
+  OutputWriter writer(out_dir, options.output);
+  Batch batch;
+
+  if (resume_from) {
+    for (const auto& [symbol, size] : resume_from->files) {
+      buffers[symbol];
+    }
+  }
+
+  while (batches.pop(batch)) {
+    for (auto& [symbol, line] : batch.lines) {
+      auto& buffer = buffers[symbol];
+      buffer += line;
+      buffer += '\n';
+
+      if (buffer.size() >= options.flush_threshold) {
+        writer.append(symbol + ".csv", buffer);
+        buffer.clear();
+      }
+    }
+
+    if (options.follow) {
+      for (auto& [symbol, buffer] : buffers) {
+        if (!buffer.empty()) {
+          writer.append(symbol + ".csv", buffer);
+          buffer.clear();
+        }
+      }
+      writer.flush();
+    }
+
+    if (batch.state) {
+      for (auto& [symbol, buffer] : buffers) {
+        writer.append(symbol + ".csv", buffer);
+        buffer.clear();
+      }
+      writer.sync();
+      save_checkpoint(batch, buffers, writer);
+    }
+  }
+
+  for (auto& [symbol, buffer] : buffers) {
+    writer.append(symbol + ".csv", buffer);
+  }
+  if (summary) {
+    summary->write(writer);
+  }
+  writer.finish();
+  writer.report();
+}
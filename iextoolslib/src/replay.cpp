@@ -0,0 +1,162 @@
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iextoolslib/replay.hpp>
+#include <iostream>
+#include <vector>
+
+using namespace IEXTools;
+
+namespace {
+
+// spin for the last stretch before a packet is due, clock_nanosleep wake-ups are not more precise than this
+const int64_t SPIN_THRESHOLD_NS = 50'000;
+
+int64_t now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1'000'000'000LL + ts.tv_nsec;
+}
+
+void wait_until(int64_t deadline_ns, bool busy_poll) {
+  if (!busy_poll && deadline_ns - now_ns() > SPIN_THRESHOLD_NS) {
+    auto wake = deadline_ns - SPIN_THRESHOLD_NS;
+    timespec ts{static_cast<time_t>(wake / 1'000'000'000LL), static_cast<long>(wake % 1'000'000'000LL)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+  }
+  while (now_ns() < deadline_ns) {
+  }
+}
+
+}  // namespace
+
+UdpReplayer::UdpReplayer(const std::string& host, uint16_t port, Options options) : options(options) {
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &destination.sin_addr) != 1) {
+    std::cerr << "Invalid IPv4 address '" << host << "'" << std::endl;
+    std::exit(1);
+  }
+
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    std::cerr << "Cannot create socket: " << std::strerror(errno) << std::endl;
+    std::exit(1);
+  }
+}
+
+UdpReplayer::~UdpReplayer() {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+UdpReplayer::Report UdpReplayer::replay(PcapReader& pcap) {
+  struct Packet {
+    double timestamp;
+    iovec payload;
+  };
+
+  std::vector<Packet> packets;
+  for (auto& frame : pcap) {
+    if (const auto* block = frame.block_as<EnhancedPacketBlock>()) {
+      auto payload = block->iex_tp.data_it - IexTpFrame::HEADER_LENGTH;
+      auto length = static_cast<std::size_t>(block->udp.length) - UDPFrame::HEADER_LENGTH;
+      packets.push_back({block->timestamp, {const_cast<std::byte*>(&*payload), length}});
+    }
+  }
+
+  Report report;
+  if (packets.empty()) {
+    return report;
+  }
+
+  auto batch = std::max(options.batch, 1u);
+  std::vector<mmsghdr> messages(batch);
+  std::vector<int64_t> errors;
+  errors.reserve(options.speed > 0 ? packets.size() : 0);
+
+  const auto start = now_ns();
+  const auto first_timestamp = packets.front().timestamp;
+  auto due = [&](std::size_t i) {
+    return options.speed > 0 ? start + static_cast<int64_t>((packets[i].timestamp - first_timestamp) * 1e9 /
+                                                            options.speed)
+                             : start;
+  };
+
+  for (std::size_t i = 0; i < packets.size();) {
+    wait_until(due(i), options.busy_poll);
+
+    // every packet that is already due goes in the same batch
+    auto now = now_ns();
+    unsigned n = 0;
+    while (n < batch && i + n < packets.size() && due(i + n) <= now) {
+      auto& message = messages[n];
+      message = {};
+      message.msg_hdr.msg_name = &destination;
+      message.msg_hdr.msg_namelen = sizeof(destination);
+      message.msg_hdr.msg_iov = &packets[i + n].payload;
+      message.msg_hdr.msg_iovlen = 1;
+      ++n;
+    }
+
+    for (unsigned sent = 0; sent < n;) {
+      auto r = sendmmsg(fd, messages.data() + sent, n - sent, 0);
+      if (r < 0) {
+        if (errno == EINTR || errno == ENOBUFS || errno == EAGAIN) {
+          continue;
+        }
+        std::cerr << "sendmmsg failed: " << std::strerror(errno) << std::endl;
+        std::exit(1);
+      }
+      sent += static_cast<unsigned>(r);
+    }
+
+    auto sent_at = now_ns();
+    for (unsigned k = 0; k < n; ++k) {
+      report.bytes += packets[i + k].payload.iov_len;
+      if (options.speed > 0) {
+        errors.push_back(sent_at - due(i + k));
+      }
+    }
+    report.packets += n;
+    i += n;
+  }
+
+  report.seconds = static_cast<double>(now_ns() - start) / 1e9;
+
+  if (!errors.empty()) {
+    double total = 0;
+    for (auto e : errors) {
+      total += static_cast<double>(e);
+    }
+    report.mean_error_ns = total / static_cast<double>(errors.size());
+    std::sort(errors.begin(), errors.end());
+    report.p50_error_ns = errors[errors.size() / 2];
+    report.p99_error_ns = errors[std::min(errors.size() - 1, errors.size() * 99 / 100)];
+    report.max_error_ns = errors.back();
+  }
+
+  return report;
+}
+
+std::ostream& operator<<(std::ostream& os, const IEXTools::UdpReplayer::Report& obj) {
+  os << "Sent " << obj.packets << " packets (" << obj.bytes << " bytes) in " << obj.seconds << " s";
+  // a capture of one burst can be sent within the clock resolution
+  if (obj.seconds > 0) {
+    os << ": " << static_cast<double>(obj.packets) / obj.seconds << " packets/s, "
+       << static_cast<double>(obj.bytes) * 8 / obj.seconds / 1e6 << " Mbit/s";
+  }
+  if (obj.max_error_ns > 0) {
+    os << "\nTiming error: mean=" << obj.mean_error_ns / 1e3 << " us p50=" << obj.p50_error_ns / 1e3
+       << " us p99=" << obj.p99_error_ns / 1e3 << " us max=" << obj.max_error_ns / 1e3 << " us";
+  }
+
+  return os;
+}
@@ -0,0 +1,109 @@
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <iextoolslib/iextools.hpp>
+#include <iextoolslib/pcap.hpp>
+#include <iextoolslib/replay.hpp>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Whole number in `value` between `min` and `max`. Anything else throws std::invalid_argument, which main reports
+unsigned long parse_count(const std::string& value, unsigned long min, unsigned long max) {
+  unsigned long count = 0;
+  auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+  if (ec != std::errc{} || end != value.data() + value.size() || count < min || count > max) {
+    throw std::invalid_argument(value);
+  }
+  return count;
+}
+
+// Finite number above 0 in `value`, or std::invalid_argument
+double parse_speed(const std::string& value) {
+  double speed = 0;
+  auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), speed);
+  if (ec != std::errc{} || end != value.data() + value.size() || !std::isfinite(speed) || speed <= 0) {
+    throw std::invalid_argument(value);
+  }
+  return speed;
+}
+
+void print_help() {
+  using namespace std;
+
+  cout << "Usage: iex-replay [OPTION]... [FILE] [HOST:PORT]\n";
+  cout << "Sends the IEX-TP UDP payloads of a pcap-ng dump file to HOST:PORT, paced by the capture timestamps.\n\n";
+
+  for (const auto& [flag, description] :
+       std::vector<std::pair<std::string, std::string>>{{"--speed=X", "replay X times faster than captured"},
+                                                        {"--max", "send as fast as possible"},
+                                                        {"--busy-poll", "spin instead of sleeping between packets"},
+                                                        {"--batch=N", "send up to N due packets per syscall (64)"},
+                                                        {"--help", "display this help and exit"}}) {
+    cout << setfill(' ') << setw(5) << " " << setw(24) << left << flag << "  " << description << "\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  IEXTools::UdpReplayer::Options options;
+  std::vector<std::string> args;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{argv[i]};
+
+    if (arg == "-h" || arg == "--help") {
+      print_help();
+      return 0;
+    } else if (arg.starts_with("--speed=") || arg.starts_with("--batch=")) {
+      try {
+        if (arg.starts_with("--speed=")) {
+          options.speed = parse_speed(arg.substr(8));
+        } else {
+          options.batch = parse_count(arg.substr(8), 1, std::numeric_limits<unsigned>::max());
+        }
+      } catch (const std::invalid_argument&) {
+        std::cerr << "Invalid value in option '" << arg << "'.\n";
+        print_help();
+        return 1;
+      }
+    } else if (arg == "--max") {
+      options.speed = 0;
+    } else if (arg == "--busy-poll") {
+      options.busy_poll = true;
+    } else if (arg.starts_with("-")) {
+      std::cerr << "Unknown option '" << arg << "'.\n";
+      print_help();
+      return 1;
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() != 2 || args[1].find(':') == std::string::npos) {
+    print_help();
+    return 1;
+  }
+  if (!std::filesystem::exists(args[0])) {
+    std::cerr << "File '" << args[0] << "' does not exist.\n";
+    return 1;
+  }
+
+  auto colon = args[1].rfind(':');
+  uint16_t port = 0;
+  try {
+    port = static_cast<uint16_t>(parse_count(args[1].substr(colon + 1), 1, std::numeric_limits<uint16_t>::max()));
+  } catch (const std::invalid_argument&) {
+    std::cerr << "Invalid port in '" << args[1] << "'.\n";
+    return 1;
+  }
+
+  IEXTools::PcapReader pcap(args[0]);
+  IEXTools::UdpReplayer replayer(args[1].substr(0, colon), port, options);
+
+  std::cout << replayer.replay(pcap) << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,495 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iextoolslib/book.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <iextoolslib/server.hpp>
+#include <iostream>
+#include <numeric>
+#include <unordered_set>
+
+using namespace IEXTools;
+
+static const Timestamp NANOS_PER_SECOND = 1000000000;
+static const std::size_t READ_SIZE = 64 << 10;
+static const std::size_t MAX_REQUEST = 4 << 10;
+static const auto YIELD_AFTER = std::chrono::seconds(1);  // idle time after which a waiting connection takes over
+
+namespace {
+
+std::vector<std::string_view> split(std::string_view line) {
+  std::vector<std::string_view> words;
+  std::size_t pos = 0;
+  while ((pos = line.find_first_not_of(" \t\r", pos)) != std::string_view::npos) {
+    auto end = std::min(line.find_first_of(" \t\r", pos), line.size());
+    words.push_back(line.substr(pos, end - pos));
+    pos = end;
+  }
+  return words;
+}
+
+template <typename T>
+void append(std::string& out, T value) {
+  char buffer[32];
+  auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, end);
+}
+
+// prices are multiples of 1/10000 dollar, printed at that precision
+void append_price(std::string& out, double price) {
+  char buffer[32];
+  auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), price, std::chars_format::fixed, 4);
+  out.append(buffer, end);
+}
+
+std::string_view trimmed(const Symbol& symbol) {
+  std::string_view s(symbol.data(), symbol.size());
+  return s.substr(0, s.find_last_not_of(' ') + 1);
+}
+
+struct QueryError {
+  std::string reason;
+};
+
+}  // namespace
+
+QueryEngine::QueryEngine(ColumnarCapture capture) : capture(std::move(capture)) {
+  const auto& trades = this->capture.trades;
+  const auto& quotes = this->capture.quotes;
+
+  auto rows_of = [this](const Symbol& symbol) -> SymbolRows& {
+    auto [it, inserted] = lookup.try_emplace(symbol_key(symbol), symbol_rows.size());
+    if (inserted) {
+      symbol_rows.push_back({symbol, {}, {}});
+    }
+    return symbol_rows[it->second];
+  };
+  // broken trades are left out of every answer, as from the trade files
+  std::unordered_set<Long> broken(this->capture.breaks.trade_id.begin(), this->capture.breaks.trade_id.end());
+  for (uint32_t i = 0; i < trades.rows(); ++i) {
+    auto& rows = rows_of(trades.symbol[i]);
+    if (!broken.contains(trades.trade_id[i])) {
+      rows.trades.push_back(i);
+    }
+  }
+  for (uint32_t i = 0; i < quotes.rows(); ++i) {
+    rows_of(quotes.symbol[i]).quotes.push_back(i);
+  }
+
+  // captures are almost always in time order already, the stable sort keeps ties in capture order
+  for (auto& s : symbol_rows) {
+    std::stable_sort(s.trades.begin(), s.trades.end(),
+                     [&trades](auto a, auto b) { return trades.timestamp[a] < trades.timestamp[b]; });
+    std::stable_sort(s.quotes.begin(), s.quotes.end(),
+                     [&quotes](auto a, auto b) { return quotes.timestamp[a] < quotes.timestamp[b]; });
+  }
+
+  std::sort(symbol_rows.begin(), symbol_rows.end(),
+            [](const auto& a, const auto& b) { return a.symbol < b.symbol; });
+  for (std::size_t i = 0; i < symbol_rows.size(); ++i) {
+    lookup[symbol_key(symbol_rows[i].symbol)] = i;
+  }
+
+  auto first = std::min(trades.rows() > 0 ? trades.timestamp.front() : std::numeric_limits<Timestamp>::max(),
+                        quotes.rows() > 0 ? quotes.timestamp.front() : std::numeric_limits<Timestamp>::max());
+  if (first != std::numeric_limits<Timestamp>::max()) {
+    std::time_t seconds = first / NANOS_PER_SECOND;
+    std::tm local{};
+    ::localtime_r(&seconds, &local);
+    local.tm_hour = local.tm_min = local.tm_sec = 0;
+    day_start = static_cast<Timestamp>(std::mktime(&local)) * NANOS_PER_SECOND;
+  }
+}
+
+const QueryEngine::SymbolRows* QueryEngine::find(std::string_view symbol) const {
+  if (symbol.size() > sizeof(Symbol)) {
+    return nullptr;
+  }
+  Symbol key;
+  key.fill(' ');
+  std::transform(symbol.begin(), symbol.end(), key.begin(), [](char c) { return std::toupper(c); });
+
+  auto it = lookup.find(symbol_key(key));
+  return it == lookup.end() ? nullptr : &symbol_rows[it->second];
+}
+
+Timestamp QueryEngine::parse_time(std::string_view text) const {
+  auto number = [&text](std::string_view part) {
+    Timestamp value = 0;
+    auto [end, ec] = std::from_chars(part.data(), part.data() + part.size(), value);
+    if (ec != std::errc() || end != part.data() + part.size()) {
+      throw QueryError{"bad time '" + std::string(text) + "'"};
+    }
+    return value;
+  };
+
+  if (text.find(':') == std::string_view::npos) {
+    return number(text);
+  }
+
+  // HH:MM[:SS[.fff]] from local midnight
+  auto first = text.find(':');
+  auto second = text.find(':', first + 1);
+  auto minutes_end = second == std::string_view::npos ? text.size() : second;
+  Timestamp t = number(text.substr(0, first)) * 3600 + number(text.substr(first + 1, minutes_end - first - 1)) * 60;
+  t *= NANOS_PER_SECOND;
+  if (second != std::string_view::npos) {
+    auto seconds = text.substr(second + 1);
+    auto dot = seconds.find('.');
+    t += number(seconds.substr(0, dot)) * NANOS_PER_SECOND;
+    if (dot != std::string_view::npos) {
+      auto fraction = seconds.substr(dot + 1, 9);
+      auto nanos = number(fraction);
+      for (auto digits = fraction.size(); digits < 9; ++digits) {
+        nanos *= 10;
+      }
+      t += nanos;
+    }
+  }
+  return day_start + t;
+}
+
+template <typename Table>
+std::pair<const uint32_t*, const uint32_t*> QueryEngine::in_range(const Table& table,
+                                                                  const std::vector<uint32_t>& rows,
+                                                                  Range range) const {
+  auto before = [&table](uint32_t row, Timestamp t) { return table.timestamp[row] < t; };
+  auto begin = std::lower_bound(rows.data(), rows.data() + rows.size(), range.begin, before);
+  auto end = std::lower_bound(begin, rows.data() + rows.size(), range.end, before);
+  return {begin, end};
+}
+
+std::string QueryEngine::answer(std::string_view request) const {
+  auto words = split(request);
+  try {
+    if (words.empty()) {
+      throw QueryError{"empty request"};
+    }
+    auto command = words[0];
+
+    auto range_from = [&](std::size_t i) {
+      Range range{std::numeric_limits<Timestamp>::min(), std::numeric_limits<Timestamp>::max()};
+      if (words.size() > i) {
+        range.begin = parse_time(words[i]);
+      }
+      if (words.size() > i + 1) {
+        range.end = parse_time(words[i + 1]);
+      }
+      if (words.size() > i + 2) {
+        throw QueryError{"too many arguments"};
+      }
+      return range;
+    };
+
+    if (command == "symbols") {
+      return symbols();
+    }
+    if (command == "top") {
+      if (words.size() < 2) {
+        throw QueryError{"usage: top N [volume|trades|notional] [FROM [TO]]"};
+      }
+      std::size_t n = 0;
+      auto [end, ec] = std::from_chars(words[1].data(), words[1].data() + words[1].size(), n);
+      if (ec != std::errc() || end != words[1].data() + words[1].size()) {
+        throw QueryError{"bad count '" + std::string(words[1]) + "'"};
+      }
+      auto has_measure = words.size() > 2 && words[2].find_first_of("0123456789") == std::string_view::npos;
+      return top(n, has_measure ? words[2] : "volume", range_from(has_measure ? 3 : 2));
+    }
+    if (command == "trades" || command == "quotes" || command == "stats") {
+      if (words.size() < 2) {
+        throw QueryError{"usage: " + std::string(command) + " SYMBOL [FROM [TO]]"};
+      }
+      const auto* rows = find(words[1]);
+      if (rows == nullptr) {
+        throw QueryError{"unknown symbol '" + std::string(words[1]) + "'"};
+      }
+      auto range = range_from(2);
+      if (command == "trades") {
+        return trades(*rows, range);
+      }
+      return command == "quotes" ? quotes(*rows, range) : stats(*rows, range);
+    }
+    throw QueryError{"unknown command '" + std::string(command) + "'"};
+  } catch (const QueryError& e) {
+    return "ERR " + e.reason + "\n";
+  }
+}
+
+std::string QueryEngine::symbols() const {
+  std::string out = "OK " + std::to_string(symbol_rows.size()) + "\n";
+  for (const auto& s : symbol_rows) {
+    out += trimmed(s.symbol);
+    out += ',';
+    append(out, s.trades.size());
+    out += ',';
+    append(out, s.quotes.size());
+    out += '\n';
+  }
+  return out;
+}
+
+std::string QueryEngine::trades(const SymbolRows& rows, Range range) const {
+  const auto& t = capture.trades;
+  auto [begin, end] = in_range(t, rows.trades, range);
+
+  std::string out = "OK " + std::to_string(end - begin) + "\n";
+  out.reserve(out.size() + static_cast<std::size_t>(end - begin) * 48);
+  for (auto row = begin; row != end; ++row) {
+    append(out, t.timestamp[*row]);
+    out += ',';
+    append(out, t.size[*row]);
+    out += ',';
+    append_price(out, t.price[*row]);
+    out += ',';
+    append(out, t.trade_id[*row]);
+    out += '\n';
+  }
+  return out;
+}
+
+std::string QueryEngine::quotes(const SymbolRows& rows, Range range) const {
+  const auto& q = capture.quotes;
+  auto [begin, end] = in_range(q, rows.quotes, range);
+
+  std::string out = "OK " + std::to_string(end - begin) + "\n";
+  out.reserve(out.size() + static_cast<std::size_t>(end - begin) * 56);
+  for (auto row = begin; row != end; ++row) {
+    append(out, q.timestamp[*row]);
+    out += ',';
+    append(out, q.bid_size[*row]);
+    out += ',';
+    append_price(out, q.bid_price[*row]);
+    out += ',';
+    append_price(out, q.ask_price[*row]);
+    out += ',';
+    append(out, q.ask_size[*row]);
+    out += '\n';
+  }
+  return out;
+}
+
+std::string QueryEngine::stats(const SymbolRows& rows, Range range) const {
+  const auto& t = capture.trades;
+  auto [begin, end] = in_range(t, rows.trades, range);
+
+  uint64_t volume = 0;
+  double notional = 0;
+  double high = 0;
+  double low = 0;
+  for (auto row = begin; row != end; ++row) {
+    volume += t.size[*row];
+    notional += t.size[*row] * t.price[*row];
+    high = row == begin ? t.price[*row] : std::max(high, t.price[*row]);
+    low = row == begin ? t.price[*row] : std::min(low, t.price[*row]);
+  }
+
+  std::string out = "OK 1\n";
+  append(out, end - begin);
+  out += ',';
+  append(out, volume);
+  out += ',';
+  append_price(out, volume > 0 ? notional / static_cast<double>(volume) : 0.0);
+  out += ',';
+  append_price(out, high);
+  out += ',';
+  append_price(out, low);
+  out += ',';
+  append(out, begin != end ? t.timestamp[*begin] : 0);
+  out += ',';
+  append(out, begin != end ? t.timestamp[*(end - 1)] : 0);
+  out += '\n';
+  return out;
+}
+
+std::string QueryEngine::top(std::size_t n, std::string_view measure, Range range) const {
+  if (measure != "volume" && measure != "trades" && measure != "notional") {
+    throw QueryError{"unknown measure '" + std::string(measure) + "'"};
+  }
+
+  const auto& t = capture.trades;
+  std::vector<std::pair<double, std::size_t>> values;  // value, symbol_rows index
+  for (std::size_t i = 0; i < symbol_rows.size(); ++i) {
+    auto [begin, end] = in_range(t, symbol_rows[i].trades, range);
+    double value = 0;
+    if (measure == "trades") {
+      value = static_cast<double>(end - begin);
+    } else {
+      for (auto row = begin; row != end; ++row) {
+        value += measure == "volume" ? t.size[*row] : t.size[*row] * t.price[*row];
+      }
+    }
+    values.emplace_back(value, i);
+  }
+
+  n = std::min(n, values.size());
+  std::partial_sort(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(n), values.end(),
+                    [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  std::string out = "OK " + std::to_string(n) + "\n";
+  for (std::size_t i = 0; i < n; ++i) {
+    out += trimmed(symbol_rows[values[i].second].symbol);
+    out += ',';
+    if (measure == "notional") {
+      append_price(out, values[i].first);
+    } else {
+      append(out, static_cast<uint64_t>(values[i].first));
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+QueryServer::QueryServer(const QueryEngine& engine, std::string socket_path, unsigned threads,
+                         std::chrono::seconds idle_timeout)
+    : engine(engine), socket_path(std::move(socket_path)), idle_timeout(idle_timeout) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (this->socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path '" << this->socket_path << "' is too long" << std::endl;
+    std::exit(1);
+  }
+  std::strcpy(address.sun_path, this->socket_path.c_str());
+
+  // a socket left behind by a server that did not exit cleanly refuses connections and is replaced
+  std::error_code ec;
+  if (std::filesystem::is_socket(this->socket_path, ec)) {
+    int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 &&
+        errno == ECONNREFUSED) {
+      ::unlink(this->socket_path.c_str());
+    }
+    if (probe >= 0) {
+      ::close(probe);
+    }
+  }
+
+  listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      ::listen(listen_fd, SOMAXCONN) < 0) {
+    std::cerr << "Cannot listen on '" << this->socket_path << "': " << std::strerror(errno) << std::endl;
+    std::exit(1);
+  }
+
+  for (unsigned i = 0; i < std::max(threads, 1u); ++i) {
+    workers.emplace_back(&QueryServer::work, this);
+  }
+}
+
+QueryServer::~QueryServer() {
+  {
+    std::lock_guard lock(mutex);
+    closing = true;
+  }
+  ready.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  while (!connections.empty()) {
+    ::close(connections.front());
+    connections.pop();
+  }
+  ::close(listen_fd);
+  ::unlink(socket_path.c_str());
+}
+
+void QueryServer::run() {
+  while (!stop_requested.load()) {
+    // the timeout bounds how late a stop request is noticed
+    pollfd pfd{listen_fd, POLLIN, 0};
+    if (::poll(&pfd, 1, 200) <= 0) {
+      continue;
+    }
+
+    int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    {
+      std::lock_guard lock(mutex);
+      connections.push(fd);
+    }
+    ready.notify_one();
+  }
+}
+
+void QueryServer::work() {
+  for (;;) {
+    int fd;
+    {
+      std::unique_lock lock(mutex);
+      ready.wait(lock, [this] { return closing || !connections.empty(); });
+      if (closing) {
+        return;
+      }
+      fd = connections.front();
+      connections.pop();
+    }
+    serve(fd);
+    ::close(fd);
+  }
+}
+
+bool QueryServer::waiting() {
+  std::lock_guard lock(mutex);
+  return !connections.empty();
+}
+
+void QueryServer::serve(int fd) {
+  std::string pending;
+  std::vector<char> buffer(READ_SIZE);
+  auto last_active = std::chrono::steady_clock::now();
+
+  for (;;) {
+    // a connection that stays idle is checked now and then, so stopping the server does not wait for clients
+    pollfd pfd{fd, POLLIN, 0};
+    auto ready = ::poll(&pfd, 1, 200);
+    if (stop_requested.load()) {
+      return;
+    }
+    if (ready <= 0) {
+      auto idle = std::chrono::steady_clock::now() - last_active;
+      if ((idle_timeout.count() > 0 && idle >= idle_timeout) || (idle >= YIELD_AFTER && waiting())) {
+        return;
+      }
+      continue;
+    }
+
+    auto n = ::read(fd, buffer.data(), buffer.size());
+    if (n <= 0) {
+      return;
+    }
+    pending.append(buffer.data(), static_cast<std::size_t>(n));
+
+    std::size_t start = 0;
+    for (auto newline = pending.find('\n'); newline != std::string::npos; newline = pending.find('\n', start)) {
+      auto response = engine.answer(std::string_view(pending).substr(start, newline - start));
+      for (std::size_t sent = 0; sent < response.size();) {
+        auto w = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (w < 0) {
+          return;
+        }
+        sent += static_cast<std::size_t>(w);
+      }
+      start = newline + 1;
+    }
+    pending.erase(0, start);
+    last_active = std::chrono::steady_clock::now();
+
+    // a line that never ends would grow without bound
+    if (pending.size() > MAX_REQUEST) {
+      static const std::string_view too_long = "ERR request too long\n";
+      ::send(fd, too_long.data(), too_long.size(), MSG_NOSIGNAL);
+      return;
+    }
+  }
+}
@@ -0,0 +1,96 @@
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <iextoolslib/cache.hpp>
+#include <iextoolslib/columns.hpp>
+#include <iextoolslib/server.hpp>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Whole number in `value` between `min` and `max`. Anything else throws std::invalid_argument, which main reports
+unsigned long parse_count(const std::string& value, unsigned long min, unsigned long max) {
+  unsigned long count = 0;
+  auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+  if (ec != std::errc{} || end != value.data() + value.size() || count < min || count > max) {
+    throw std::invalid_argument(value);
+  }
+  return count;
+}
+
+void print_help() {
+  using namespace std;
+
+  cout << "Usage: iex-server [OPTION]... [FILE] [SOCKET]\n";
+  cout << "Decodes the trades and quotes of a TOPS capture once and answers queries on the Unix socket SOCKET.\n\n";
+
+  for (const auto& [flag, description] : std::vector<std::pair<std::string, std::string>>{
+           {"--threads=N", "serve up to N connections at once (number of cores)"},
+           {"--idle-timeout=SECONDS", "close connections idle for SECONDS, 0 for never (60)"},
+           {"--cache=DIR", "reuse the capture decoded by an earlier run, kept in DIR"},
+           {"--help", "display this help and exit"}}) {
+    cout << setfill(' ') << setw(5) << " " << setw(24) << left << flag << "  " << description << "\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+  std::chrono::seconds idle_timeout(60);
+  std::string cache_dir;
+  std::vector<std::string> args;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg{argv[i]};
+
+    if (arg == "-h" || arg == "--help") {
+      print_help();
+      return 0;
+    } else if (arg.starts_with("--threads=") || arg.starts_with("--idle-timeout=")) {
+      try {
+        if (arg.starts_with("--threads=")) {
+          threads = parse_count(arg.substr(10), 1, 1024);
+        } else {
+          idle_timeout = std::chrono::seconds(parse_count(arg.substr(15), 0, std::numeric_limits<int>::max()));
+        }
+      } catch (const std::invalid_argument&) {
+        std::cerr << "Invalid value in option '" << arg << "'.\n";
+        print_help();
+        return 1;
+      }
+    } else if (arg.starts_with("--cache=")) {
+      cache_dir = arg.substr(8);
+    } else if (arg.starts_with("-")) {
+      std::cerr << "Unknown option '" << arg << "'.\n";
+      print_help();
+      return 1;
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() != 2) {
+    print_help();
+    return 1;
+  }
+  if (!std::filesystem::exists(args[0])) {
+    std::cerr << "File '" << args[0] << "' does not exist.\n";
+    return 1;
+  }
+
+  IEXTools::QueryEngine engine(cache_dir.empty() ? IEXTools::ColumnarCapture::decode(args[0])
+                                                : IEXTools::CaptureCache(cache_dir).load(args[0]));
+  IEXTools::QueryServer server(engine, args[1], threads, idle_timeout);
+
+  std::signal(SIGINT, [](int) { IEXTools::QueryServer::request_stop(); });
+  std::signal(SIGTERM, [](int) { IEXTools::QueryServer::request_stop(); });
+
+  std::cerr << "Serving " << args[0] << " on " << args[1] << std::endl;
+  server.run();
+
+  return 0;
+}
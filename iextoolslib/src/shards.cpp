@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <iextoolslib/book.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <iextoolslib/shards.hpp>
+#include <iextoolslib/tops.hpp>
+
+using namespace IEXTools;
+
+static const std::size_t SHARD_BATCH_SIZE = 4096;
+static const std::size_t SHARD_RING_CAPACITY = 8;
+// every routed message starts with its flags or status byte, followed by the timestamp and the symbol
+static const std::size_t SYMBOL_OFFSET = sizeof(Byte) + sizeof(Timestamp);
+
+TopsShards::TopsShards(std::filesystem::path out_dir, unsigned shard_count, OutputOptions output, bool join_quotes,
+                       bool summary)
+    : out_dir(out_dir),
+      shard_count(std::max(shard_count, 1u)),
+      join_quotes(join_quotes),
+      summary(summary),
+      writer(std::move(out_dir), output) {
+  for (unsigned i = 0; i < this->shard_count; ++i) {
+    shards.push_back(std::make_unique<Shard>(SHARD_RING_CAPACITY));
+  }
+  for (auto& shard : shards) {
+    shard->worker = std::thread(&TopsShards::work, this, std::ref(*shard));
+  }
+}
+
+TopsShards::~TopsShards() {
+  if (!finished) {
+    for (auto& shard : shards) {
+      shard->ring.close();
+      shard->worker.join();
+    }
+  }
+}
+
+uint32_t TopsShards::intern(const Symbol& symbol) {
+  auto [it, inserted] = symbol_ids.try_emplace(symbol_key(symbol), static_cast<uint32_t>(symbol_ids.size()));
+  return it->second;
+}
+
+void TopsShards::route(const EnhancedPacketBlock& packet) {
+  packet.iex_tp.for_each_message([this](Byte message_type, pcap_cit_t it, Short length) {
+    if (message_type != TradeReportType && message_type != TradeBreakType &&
+        !(join_quotes && message_type == QuoteUpdateType)) {
+      return;
+    }
+    if (message_type == TradeBreakType) {
+      breaks += TopsReader::format_break(*TradeBreakMessage::from_raw_message(it));
+      breaks += '\n';
+    }
+
+    auto symbol_it = it + SYMBOL_OFFSET;
+    auto symbol_id = intern(read_bytes<Symbol>(symbol_it));
+    auto& shard = *shards[symbol_id % shard_count];
+    auto& batch = shard.pending;
+
+    batch.records.push_back({symbol_id, message_type, static_cast<uint32_t>(batch.bytes.size())});
+    batch.bytes.insert(batch.bytes.end(), it, it + length);
+
+    if (batch.records.size() >= SHARD_BATCH_SIZE) {
+      push(shard);
+    }
+  });
+}
+
+void TopsShards::push(Shard& shard) {
+  shard.ring.push(std::move(shard.pending));
+  shard.pending = {};
+  shard.pending.records.reserve(SHARD_BATCH_SIZE);
+}
+
+void TopsShards::work(Shard& shard) {
+  Batch batch;
+
+  while (shard.ring.pop(batch)) {
+    for (const auto& record : batch.records) {
+      auto local_id = record.symbol_id / shard_count;
+      if (local_id >= shard.states.size()) {
+        shard.states.resize(local_id + 1);
+      }
+      auto& state = shard.states[local_id];
+      auto it = batch.bytes.cbegin() + record.offset;
+
+      if (record.message_type == QuoteUpdateType) {
+        shard.join.on_quote(*QuoteUpdateMessage::from_raw_message(it));
+        continue;
+      }
+      if (record.message_type == TradeBreakType) {
+        auto message = TradeBreakMessage::from_raw_message(it);
+        if (auto position = shard.index.erase(message->trade_id)) {
+          shard.states[position->local_id].broken.emplace_back(position->offset, position->length);
+        }
+        if (summary) {
+          shard.summary.on_break(*message);
+        }
+        continue;
+      }
+
+      auto message = TradeReportMessage::from_raw_message(it);
+      if (summary) {
+        shard.summary.add(*message);
+      }
+      if (state.name.empty()) {
+        state.name = symbol_to_string(message->symbol);
+      }
+      auto offset = state.lines.size();
+      state.lines += TopsReader::format_trade(*message, join_quotes ? &shard.join : nullptr);
+      state.lines += '\n';
+      shard.index.insert(message->trade_id,
+                         {local_id, static_cast<uint32_t>(state.lines.size() - offset), offset});
+    }
+  }
+
+  write_files(shard);
+}
+
+void TopsShards::write_files(Shard& shard) {
+  for (auto& state : shard.states) {
+    if (state.name.empty()) {
+      continue;
+    }
+
+    if (!state.broken.empty()) {
+      std::sort(state.broken.begin(), state.broken.end());
+      std::string kept;
+      std::size_t from = 0;
+      for (auto [offset, length] : state.broken) {
+        kept.append(state.lines, from, offset - from);
+        from = offset + length;
+      }
+      kept.append(state.lines, from);
+      state.lines = std::move(kept);
+    }
+
+    writer.append(state.name + ".csv", state.lines);
+    state.lines = {};
+  }
+}
+
+void TopsShards::finish() {
+  for (auto& shard : shards) {
+    if (!shard->pending.records.empty()) {
+      push(*shard);
+    }
+    shard->ring.close();
+  }
+
+  for (auto& shard : shards) {
+    shard->worker.join();
+  }
+  finished = true;
+
+  if (!breaks.empty()) {
+    writer.append(std::string(TopsReader::BREAKS) + ".csv", breaks);
+  }
+
+  if (summary) {
+    DailySummary all;
+    for (auto& shard : shards) {
+      all.merge(std::move(shard->summary));
+    }
+    all.write(writer);
+  }
+  writer.finish();
+  writer.report();
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iextoolslib/spill.hpp>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <utility>
+
+using namespace IEXTools;
+
+// Runs are sequences of groups, one per symbol: u32 name length, name, u32 line count, u8 whether lines carry a trade
+// id, then every line as its u64 trade id when they do, u32 length and bytes. Broken trades are written with length 0
+static const std::size_t RUN_BUFFER_SIZE = 1 << 20;
+
+namespace {
+
+template <typename T>
+void write_value(std::ofstream& os, T value) {
+  os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T read_value(std::ifstream& is) {
+  T value{};
+  is.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+struct RunReader {
+  explicit RunReader(const std::filesystem::path& path) : buffer(RUN_BUFFER_SIZE) {
+    is.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    is.open(path, std::ios::binary);
+    if (!is) {
+      std::cerr << "Cannot open spilled run " << path << std::endl;
+      std::exit(1);
+    }
+    next_group();
+  }
+
+  // Reads the header of the next group, false at the end of the run
+  bool next_group() {
+    auto length = read_value<uint32_t>(is);
+    if (!is) {
+      return false;
+    }
+    name.resize(length);
+    is.read(name.data(), length);
+    count = read_value<uint32_t>(is);
+    with_ids = read_value<uint8_t>(is) != 0;
+    return static_cast<bool>(is);
+  }
+
+  std::vector<char> buffer;
+  std::ifstream is;
+  std::string name;
+  uint32_t count = 0;
+  bool with_ids = false;
+};
+
+}  // namespace
+
+SpillRuns::SpillRuns(std::filesystem::path dir) : dir(std::move(dir)) { std::filesystem::create_directories(this->dir); }
+
+SpillRuns::~SpillRuns() {
+  std::error_code ec;
+  std::filesystem::remove_all(dir, ec);
+}
+
+void SpillRuns::spill(std::map<std::string, SymbolLines>& data) {
+  auto path = dir / ("run-" + std::to_string(runs.size()) + ".bin");
+  std::vector<char> buffer(RUN_BUFFER_SIZE);
+  std::ofstream os;
+  os.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  os.open(path, std::ios::binary);
+
+  // the map iterates in symbol order, so the run comes out sorted
+  for (auto& [symbol, store] : data) {
+    if (store.lines.empty()) {
+      continue;
+    }
+    write_value<uint32_t>(os, static_cast<uint32_t>(symbol.size()));
+    os.write(symbol.data(), static_cast<std::streamsize>(symbol.size()));
+    write_value<uint32_t>(os, static_cast<uint32_t>(store.lines.size()));
+    write_value<uint8_t>(os, store.trade_ids.empty() ? 0 : 1);
+    for (std::size_t i = 0; i < store.lines.size(); ++i) {
+      if (!store.trade_ids.empty()) {
+        write_value<Long>(os, store.trade_ids[i]);
+      }
+      write_value<uint32_t>(os, static_cast<uint32_t>(store.lines[i].size()));
+      os.write(store.lines[i].data(), static_cast<std::streamsize>(store.lines[i].size()));
+    }
+
+    // give the memory back
+    std::vector<std::string>().swap(store.lines);
+    std::vector<Long>().swap(store.trade_ids);
+  }
+
+  os.close();
+  if (!os) {
+    std::cerr << "Error writing spilled run " << path << std::endl;
+    std::exit(1);
+  }
+  runs.push_back(path);
+}
+
+void SpillRuns::merge(const std::vector<Long>& broken, OutputWriter& writer) const {
+  std::vector<std::unique_ptr<RunReader>> readers;
+  using Head = std::pair<std::string, std::size_t>;  // symbol, reader (runs are numbered in capture order)
+  std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+
+  for (const auto& run : runs) {
+    readers.push_back(std::make_unique<RunReader>(run));
+    if (readers.back()->is) {
+      heads.emplace(readers.back()->name, readers.size() - 1);
+    }
+  }
+
+  std::string buffer;
+  std::string line;
+  while (!heads.empty()) {
+    auto [symbol, index] = heads.top();
+    heads.pop();
+    auto& reader = *readers[index];
+
+    for (uint32_t i = 0; i < reader.count; ++i) {
+      auto trade_id = reader.with_ids ? read_value<Long>(reader.is) : 0;
+      line.resize(read_value<uint32_t>(reader.is));
+      reader.is.read(line.data(), static_cast<std::streamsize>(line.size()));
+      if (line.empty() || (reader.with_ids && std::binary_search(broken.cbegin(), broken.cend(), trade_id))) {
+        continue;  // broken trade
+      }
+      buffer += line;
+      buffer += '\n';
+    }
+    writer.append(symbol + ".csv", buffer);
+    buffer.clear();
+
+    if (reader.next_group()) {
+      heads.emplace(reader.name, index);
+    }
+  }
+}
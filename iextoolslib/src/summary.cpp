@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iextoolslib/pcap_utils.hpp>
+#include <iextoolslib/summary.hpp>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace IEXTools;
+
+namespace {
+
+struct Reduction {
+  uint64_t volume = 0;
+  double notional = 0;
+  double high = std::numeric_limits<double>::lowest();
+  double low = std::numeric_limits<double>::max();
+};
+
+void reduce_scalar(const Integer* sizes, const double* prices, std::size_t begin, std::size_t end, Reduction& r) {
+  for (auto i = begin; i < end; ++i) {
+    r.volume += sizes[i];
+    r.notional += sizes[i] * prices[i];
+    r.high = std::max(r.high, prices[i]);
+    r.low = std::min(r.low, prices[i]);
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) Reduction reduce_avx2(const Integer* sizes, const double* prices, std::size_t n) {
+  auto volume = _mm256_setzero_si256();
+  auto notional = _mm256_setzero_pd();
+  auto high = _mm256_set1_pd(std::numeric_limits<double>::lowest());
+  auto low = _mm256_set1_pd(std::numeric_limits<double>::max());
+  // a 32 bit size put in the mantissa of 2^52 converts exactly, AVX2 only converts signed 32 bit integers
+  const auto two_52 = _mm256_set1_epi64x(0x4330000000000000);
+
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    auto s = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sizes + i)));
+    auto p = _mm256_loadu_pd(prices + i);
+    volume = _mm256_add_epi64(volume, s);
+    auto size = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(s, two_52)), _mm256_castsi256_pd(two_52));
+    notional = _mm256_add_pd(notional, _mm256_mul_pd(size, p));
+    high = _mm256_max_pd(high, p);
+    low = _mm256_min_pd(low, p);
+  }
+
+  alignas(32) uint64_t v[4];
+  alignas(32) double t[4], h[4], l[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(v), volume);
+  _mm256_store_pd(t, notional);
+  _mm256_store_pd(h, high);
+  _mm256_store_pd(l, low);
+
+  Reduction r;
+  for (int k = 0; k < 4; ++k) {
+    r.volume += v[k];
+    r.notional += t[k];
+    r.high = std::max(r.high, h[k]);
+    r.low = std::min(r.low, l[k]);
+  }
+  reduce_scalar(sizes, prices, i, n, r);
+
+  return r;
+}
+#endif
+
+Reduction reduce(const TradeColumns& c) {
+#if defined(__x86_64__) || defined(__i386__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+
+  if (has_avx2) {
+    return reduce_avx2(c.sizes.data(), c.prices.data(), c.size());
+  }
+#endif
+  Reduction r;
+  reduce_scalar(c.sizes.data(), c.prices.data(), 0, c.size(), r);
+  return r;
+}
+
+}  // namespace
+
+TradeColumns TradeColumns::without_broken() const {
+  auto skip = broken;
+  std::sort(skip.begin(), skip.end());
+
+  TradeColumns kept;
+  auto next = skip.cbegin();
+  for (std::size_t i = 0; i < size(); ++i) {
+    if (next != skip.cend() && *next == i) {
+      ++next;
+      continue;
+    }
+    kept.timestamps.push_back(timestamps[i]);
+    kept.sizes.push_back(sizes[i]);
+    kept.prices.push_back(prices[i]);
+  }
+  return kept;
+}
+
+SymbolSummary SymbolSummary::compute(const TradeColumns& columns) {
+  if (!columns.broken.empty()) {
+    return compute(columns.without_broken());
+  }
+
+  SymbolSummary s;
+  if (columns.size() == 0) {
+    return s;
+  }
+
+  auto r = reduce(columns);
+  s.trades = columns.size();
+  s.volume = r.volume;
+  s.notional = r.notional;
+  s.high = r.high;
+  s.low = r.low;
+  s.first_time = columns.timestamps.front();
+  s.last_time = columns.timestamps.back();
+
+  // nearest-rank percentiles, each selection only partitions what is left after the previous one
+  auto prices = columns.prices;
+  auto from = prices.begin();
+  for (std::size_t k = 0; k < PERCENTILES.size(); ++k) {
+    auto rank = static_cast<std::size_t>(PERCENTILES[k] * static_cast<double>(prices.size() - 1) + 0.5);
+    auto nth = prices.begin() + static_cast<std::ptrdiff_t>(rank);
+    std::nth_element(from, nth, prices.end());
+    s.price_percentiles[k] = *nth;
+    from = nth;
+  }
+
+  return s;
+}
+
+void DailySummary::add(const TradeReportMessage& trade) {
+  auto& c = columns[symbol_to_string(trade.symbol)];
+  index.insert(trade.trade_id, {&c, c.size()});
+  c.push_back(trade);
+}
+
+void DailySummary::on_break(const TradeBreakMessage& trade_break) {
+  if (auto position = index.erase(trade_break.trade_id)) {
+    position->first->broken.push_back(position->second);
+  }
+}
+
+void DailySummary::merge(DailySummary&& other) { columns.merge(other.columns); }
+
+std::map<std::string, SymbolSummary> DailySummary::compute() const {
+  std::vector<std::pair<const std::string*, const TradeColumns*>> work;
+  for (const auto& [symbol, c] : columns) {
+    work.emplace_back(&symbol, &c);
+  }
+
+  std::vector<SymbolSummary> results(work.size());
+  std::atomic<std::size_t> next{0};
+  auto worker = [&] {
+    for (auto i = next++; i < work.size(); i = next++) {
+      results[i] = SymbolSummary::compute(*work[i].second);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  auto thread_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), work.size());
+  for (std::size_t i = 1; i < thread_count; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::map<std::string, SymbolSummary> summaries;
+  for (std::size_t i = 0; i < work.size(); ++i) {
+    summaries.emplace(*work[i].first, results[i]);
+  }
+  return summaries;
+}
+
+void DailySummary::write(OutputWriter& writer) const {
+  std::stringstream ss;
+  ss << std::fixed;
+  ss << "symbol,trades,volume,notional,vwap,high,low,first_time,last_time,p5,p25,p50,p75,p95\n";
+
+  for (const auto& [symbol, s] : compute()) {
+    auto vwap = s.volume > 0 ? s.notional / static_cast<double>(s.volume) : 0;
+    ss << symbol << "," << s.trades << "," << s.volume << "," << std::setprecision(2) << s.notional << ","
+       << std::setprecision(4) << vwap << "," << s.high << "," << s.low << "," << s.first_time << "," << s.last_time;
+    for (auto p : s.price_percentiles) {
+      ss << "," << p;
+    }
+    ss << "\n";
+  }
+
+  writer.append("summary.csv", ss.str());
+}
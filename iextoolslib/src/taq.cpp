@@ -0,0 +1,77 @@
+#include <cmath>
+#include <iextoolslib/book.hpp>
+#include <iextoolslib/pcap_utils.hpp>
+#include <iextoolslib/taq.hpp>
+#include <sstream>
+
+using namespace IEXTools;
+
+void QuoteJoin::on_quote(const QuoteUpdateMessage& quote) {
+  auto& state = states[symbol_key(quote.symbol)];
+  state.bid_price = quote.bid_price;
+  state.bid_size = quote.bid_size;
+  state.ask_price = quote.ask_price;
+  state.ask_size = quote.ask_size;
+}
+
+void QuoteJoin::save(std::ostream& os) const {
+  os << states.size() << "\n";
+  for (const auto& [key, s] : states) {
+    os << key << " " << s.bid_price << " " << s.bid_size << " " << s.ask_price << " " << s.ask_size << " "
+       << s.last_trade_price << " " << static_cast<int>(s.last_side) << "\n";
+  }
+}
+
+void QuoteJoin::load(std::istream& is) {
+  std::size_t count = 0;
+  is >> count;
+  states.clear();
+
+  for (std::size_t i = 0; i < count && is; ++i) {
+    uint64_t key = 0;
+    State s;
+    int last_side = 0;
+    is >> key >> s.bid_price >> s.bid_size >> s.ask_price >> s.ask_size >> s.last_trade_price >> last_side;
+    s.last_side = static_cast<char>(last_side);
+    states.emplace(key, s);
+  }
+}
+
+std::string QuoteJoin::enrich(const TradeReportMessage& trade) {
+  auto& state = states[symbol_key(trade.symbol)];
+  auto price = static_cast<Price>(std::llround(trade.price * 1e4));
+  bool two_sided = state.bid_price > 0 && state.ask_price > 0;
+
+  // compare doubled prices to keep the midpoint an integer
+  char side = 0;
+  if (two_sided && 2 * price > state.bid_price + state.ask_price) {
+    side = 'B';
+  } else if (two_sided && 2 * price < state.bid_price + state.ask_price) {
+    side = 'S';
+  } else if (state.last_trade_price > 0 && price != state.last_trade_price) {
+    side = price > state.last_trade_price ? 'B' : 'S';
+  } else {
+    side = state.last_side;  // zero tick, keeps the side of the previous trade
+  }
+  state.last_trade_price = price;
+  state.last_side = side;
+
+  std::stringstream ss;
+  if (two_sided) {
+    auto midpoint = price_to_double(state.bid_price + state.ask_price) / 2;
+    ss << "," << price_to_double(state.bid_price) << "," << state.bid_size << "," << price_to_double(state.ask_price)
+       << "," << state.ask_size << ",";
+    if (side != 0) {
+      ss << side;
+    }
+    ss << "," << 2 * std::abs(trade.price - midpoint);
+  } else {
+    ss << ",,,,,";
+    if (side != 0) {
+      ss << side;
+    }
+    ss << ",";
+  }
+
+  return ss.str();
+}
@@ -1,85 +1,368 @@
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <iextoolslib/cache.hpp>
 #include <iextoolslib/pcap_utils.hpp>
+#include <iextoolslib/pipeline.hpp>
+#include <iextoolslib/shards.hpp>
 #include <iextoolslib/tops.hpp>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 
 using namespace IEXTools;
 
-TopsReader::TopsReader(const std::string& file_path, const std::string& out_dir) : pcap(file_path), out_dir(out_dir) {
-  parse_data();
+static const std::size_t DUMP_BUFFER_SIZE = 1 << 20;
+static const std::size_t READ_CHUNK_SIZE = 8 << 20;
+// allocator header, vector slack, trade id and index slots that come with every buffered line, roughly
+static const std::size_t LINE_OVERHEAD = 64;
+
+// Lowers the budgets of `options` to their share of its memory limit
+static TopsOptions within_limit(TopsOptions options) {
+  if (options.memory_limit == 0) {
+    return options;
+  }
+  MemoryLimits limits(options.memory_limit);
+  auto lower = [](std::size_t& budget, std::size_t share) { budget = budget > 0 ? std::min(budget, share) : share; };
+  lower(options.memory_budget, limits.messages);
+  lower(options.output.buffer_limit, limits.output);
+  return options;
+}
+
+// cached columns hold prices as dollars, converted back exactly to the raw 1/10000 dollar units
+static Price double_to_price(double price) { return std::llround(price * 10000); }
+
+TopsReader::TopsReader(const std::string& file_path, const std::string& out_dir, TopsOptions requested)
+    : options(within_limit(std::move(requested))), out_dir(out_dir) {
+  if (options.pipelined || options.follow || options.checkpoint_interval > 0 || options.resume) {
+    TopsPipeline::Options pipeline_options;
+    pipeline_options.follow = options.follow;
+    pipeline_options.idle_timeout = options.follow_idle_timeout;
+    pipeline_options.output = options.output;
+    pipeline_options.join_quotes = options.join_quotes;
+    pipeline_options.checkpoint_interval = options.checkpoint_interval;
+    pipeline_options.resume = options.resume;
+    pipeline_options.summary = options.summary;
+    pipeline_options.verify_checksums = options.verify_checksums;
+    pipeline_options.conflation = options.conflation;
+    if (options.memory_limit > 0) {
+      pipeline_options.read_size = MemoryLimits(options.memory_limit).read_chunk;
+    }
+
+    TopsPipeline(file_path, out_dir, pipeline_options).run();
+    return;
+  }
+
+  if (options.verify_checksums) {
+    verifier.emplace(out_dir);
+  }
+  if (options.shards > 1) {
+    shards.emplace(out_dir, options.shards, options.output, options.join_quotes, options.summary);
+  } else {
+    if (options.join_quotes) {
+      join.emplace();
+    }
+    if (options.summary) {
+      summary.emplace();
+    }
+    if (options.conflation.enabled()) {
+      conflator.emplace(options.conflation);
+    }
+  }
+  if (shards) {
+    pcap.emplace(file_path);
+    parse_data();
+  } else if (!options.cache_dir.empty()) {
+    parse_columns(CaptureCache(options.cache_dir).load(file_path));
+  } else {
+    parse_chunks(file_path);
+  }
   dump_files();
 }
 
-std::vector<std::unique_ptr<TopsMessage>> TopsReader::get_messages(EnhancedPacketBlock* packet) {
+std::vector<std::unique_ptr<TopsMessage>> TopsReader::get_messages(const EnhancedPacketBlock* packet) {
   std::vector<std::unique_ptr<TopsMessage>> messages{};
-  auto& iex = packet->iex_tp;
 
-  unsigned total_length = 0;
-
-  if (iex.payload_length > 0 && iex.message_count > 0) {
-    messages.reserve(iex.message_count);
+  on_packet(packet->iex_tp.send_time);
+  packet->iex_tp.for_each_message([this](Byte message_type, pcap_cit_t it) {
+    if (message_type == TradeReportType) {
+      on_trade(*TradeReportMessage::from_raw_message(it));
+    } else if (message_type == QuoteUpdateType && (join || conflator)) {
+      on_quote(*QuoteUpdateMessage::from_raw_message(it));
+    } else if (message_type == TradeBreakType) {
+      on_break(*TradeBreakMessage::from_raw_message(it));
+    }
+  });
+  store_quotes();
 
-    for (int i = 0; i < iex.message_count; ++i) {
-      auto it{packet->iex_tp.data_it + total_length};
-      auto message_length = read_bytes<Short>(it);
-      total_length += message_length + sizeof(message_length);
+  return messages;
+}
 
-      if (total_length > iex.payload_length) {
-        std::exit(1);
-      }
+void TopsReader::parse_columns(const ColumnarCapture& capture) {
+  const auto& t = capture.trades;
+  const auto& q = capture.quotes;
+  const auto& b = capture.breaks;
+  std::size_t packet = 0;
+  std::size_t trade = 0;
+  std::size_t quote = 0;
+  std::size_t broken = 0;
 
-      auto message_type = read_bytes<Byte>(it);
-
-      if (message_type == TradeReportType) {
-        auto message = TradeReportMessage::from_raw_message(it);
-        std::stringstream ss;
-        ss << message->timestamp << "," << message->size << "," << message->price;
-        auto symbol{symbol_to_string(message->symbol)};
-        if (auto iter = data.find(symbol); iter != data.end()) {
-          iter->second.emplace_back(ss.str());
-        } else {
-          data[symbol] = {ss.str()};
+  for (auto event : capture.events) {
+    switch (event) {
+      case ColumnarCapture::PACKET:
+        store_quotes();
+        if (options.memory_budget > 0) {
+          spill_if_needed();
         }
+        on_packet(capture.packets[packet++]);
+        break;
+      case TradeReportType:
+        on_trade(TradeReportMessage(t.flags[trade], t.timestamp[trade], t.symbol[trade], t.size[trade],
+                                    t.price[trade], t.trade_id[trade]));
+        ++trade;
+        break;
+      case QuoteUpdateType:
+        if (join || conflator) {
+          on_quote(QuoteUpdateMessage(q.flags[quote], q.timestamp[quote], q.symbol[quote], q.bid_size[quote],
+                                      double_to_price(q.bid_price[quote]), q.ask_size[quote],
+                                      double_to_price(q.ask_price[quote])));
+        }
+        ++quote;
+        break;
+      case TradeBreakType:
+        on_break(TradeBreakMessage(b.flags[broken], b.timestamp[broken], b.symbol[broken], b.size[broken],
+                                   double_to_price(b.price[broken]), b.trade_id[broken]));
+        ++broken;
+        break;
+    }
+  }
+  store_quotes();
+}
 
-      } else {
-        it += message_length - sizeof(message_type);
+void TopsReader::on_packet(Timestamp send_time) {
+  if (conflator) {
+    conflator->advance(send_time, quote_lines);
+  }
+}
+
+void TopsReader::on_trade(const TradeReportMessage& message) {
+  if (summary) {
+    summary->add(message);
+  }
+  auto symbol{symbol_to_string(message.symbol)};
+  auto& store = data[symbol];
+  trade_lines.insert(message.trade_id, {&store, store.lines.size()});
+  store.lines.emplace_back(format_trade(message, join ? &*join : nullptr));
+  if (options.memory_budget > 0) {
+    store.trade_ids.push_back(message.trade_id);
+  }
+  count_line(store.lines.back());
+}
+
+void TopsReader::on_quote(const QuoteUpdateMessage& message) {
+  if (join) {
+    join->on_quote(message);
+  }
+  if (conflator) {
+    conflator->on_quote(message, quote_lines);
+  }
+}
+
+void TopsReader::on_break(const TradeBreakMessage& message) {
+  if (auto position = trade_lines.erase(message.trade_id)) {
+    position->first->lines[position->second].clear();
+  } else if (runs) {
+    spilled_breaks.push_back(message.trade_id);
+  }
+  if (summary) {
+    summary->on_break(message);
+  }
+  data[BREAKS].lines.emplace_back(format_break(message));
+}
+
+void TopsReader::store_quotes() {
+  for (auto& [file, line] : quote_lines) {
+    auto& store = data[file];
+    store.lines.emplace_back(std::move(line));
+    count_line(store.lines.back());
+  }
+  quote_lines.clear();
+}
+
+void TopsReader::format_trades(const IexTpFrame& iex_tp, std::vector<std::pair<std::string, std::string>>& lines,
+                               QuoteJoin* join, DailySummary* summary, QuoteConflator* conflator) {
+  if (conflator != nullptr) {
+    conflator->advance(iex_tp.send_time, lines);
+  }
+
+  iex_tp.for_each_message([&lines, join, summary, conflator](Byte message_type, pcap_cit_t it) {
+    if (message_type == TradeReportType) {
+      auto message = TradeReportMessage::from_raw_message(it);
+      if (summary != nullptr) {
+        summary->add(*message);
+      }
+      lines.emplace_back(symbol_to_string(message->symbol), format_trade(*message, join));
+    } else if (message_type == QuoteUpdateType && (join != nullptr || conflator != nullptr)) {
+      auto message = QuoteUpdateMessage::from_raw_message(it);
+      if (join != nullptr) {
+        join->on_quote(*message);
+      }
+      if (conflator != nullptr) {
+        conflator->on_quote(*message, lines);
       }
+    } else if (message_type == TradeBreakType) {
+      auto message = TradeBreakMessage::from_raw_message(it);
+      if (summary != nullptr) {
+        summary->on_break(*message);
+      }
+      lines.emplace_back(BREAKS, format_break(*message));
     }
-  }
+  });
+}
 
-  if (total_length != iex.payload_length) {
-    std::cerr << "total_length != iex.payload_length" << std::endl;
-    // std:exit(1);
+std::string TopsReader::format_trade(const TradeReportMessage& message, QuoteJoin* join) {
+  std::stringstream ss;
+  ss << message.timestamp << "," << message.size << "," << message.price;
+  if (join != nullptr) {
+    ss << join->enrich(message);
   }
+  return ss.str();
+}
 
-  return messages;
+std::string TopsReader::format_break(const TradeBreakMessage& message) {
+  std::stringstream ss;
+  ss << symbol_to_string(message.symbol) << "," << message.timestamp << "," << message.size << ","
+     << price_to_double(message.price) << "," << message.trade_id;
+  return ss.str();
 }
 
 void TopsReader::parse_data() {
-  for (auto& pcap_frame : pcap) {
-    if (pcap_frame.type == PcapFrame::ENHANCED_PACKET_BLOCK_TYPE) {
-      auto* enhanced_packet = dynamic_cast<EnhancedPacketBlock*>(pcap_frame.block.get());
-
-      if (enhanced_packet != nullptr) {
-        get_messages(enhanced_packet);
+  for (auto& pcap_frame : *pcap) {
+    if (const auto* enhanced_packet = pcap_frame.block_as<EnhancedPacketBlock>()) {
+      if (verifier && !verifier->verify(pcap_frame, *enhanced_packet)) {
+        continue;
+      }
+      if (shards) {
+        shards->route(*enhanced_packet);
       } else {
-        std::cerr << "Error accessing Enhanced Packet Block: bad dynamic casting" << std::endl;
+        get_messages(enhanced_packet);
       }
     }
   }
 }
-void TopsReader::dump_files() const {
-  for (auto const& [symbol, values] : data) {
-    std::filesystem::path out_file_path{out_dir};
-    out_file_path /= std::string(symbol.cbegin(), symbol.cend()) + ".csv";
-    std::ofstream os(out_file_path);
+void TopsReader::parse_chunks(const std::string& file_path) {
+  std::ifstream is(file_path, std::ios::binary);
+  std::vector<std::byte> chunk;
+  std::size_t carry = 0;  // bytes of a block not complete in the previous chunk
+  std::pmr::monotonic_buffer_resource arena(1 << 20, &Memory::frames);
+  const auto chunk_size = options.memory_limit > 0 ? MemoryLimits(options.memory_limit).read_chunk : READ_CHUNK_SIZE;
+  MemoryHold chunk_memory(Memory::reader, 0);
+  unsigned frame_number = 0;
+  ColumnarCapture batch;
+  ColumnDecoder decoder(batch);
 
-    std::cout << out_file_path << std::endl;
+  while (is) {
+    // top the carried bytes up to a full chunk, so the buffer keeps its size
+    auto want = carry < chunk_size ? chunk_size - carry : chunk_size;
+    chunk.resize(carry + want);
+    chunk_memory.resize(chunk.capacity());
+    is.read(reinterpret_cast<char*>(chunk.data() + carry), static_cast<std::streamsize>(want));
+    auto size = carry + static_cast<std::size_t>(is.gcount());
+    auto complete = PcapReader::complete_blocks_size(chunk.data(), size);
+    chunk.resize(size);
 
-    for (auto& value : values) {
-      os << value << "\n";
+    auto end = chunk.cbegin() + static_cast<std::ptrdiff_t>(complete);
+    for (auto it = chunk.cbegin(); it != end;) {
+      auto frame = PcapReader::read_frame(it, frame_number++, &arena);
+      if (const auto* enhanced_packet = frame.block_as<EnhancedPacketBlock>()) {
+        if (verifier && !verifier->verify(frame, *enhanced_packet)) {
+          continue;
+        }
+        decoder.on_packet(enhanced_packet->iex_tp);
+      }
     }
-    os.close();
+    // the collected messages point into the chunk
+    decoder.flush();
+    parse_columns(batch);
+    batch = {};
+    arena.release();
+
+    carry = size - complete;
+    std::copy(end, chunk.cend(), chunk.begin());
+  }
+
+  if (carry > 0) {
+    capture_error("length mismatch");
   }
 }
+
+void TopsReader::count_line(const std::string& line) {
+  auto bytes = sizeof(std::string) + line.capacity() + LINE_OVERHEAD;
+  buffered_bytes += bytes;
+  Memory::messages.charge(bytes);
+}
+
+void TopsReader::spill_if_needed() {
+  if (buffered_bytes < options.memory_budget) {
+    return;
+  }
+  if (!runs) {
+    runs.emplace(out_dir / ".spill");
+  }
+  runs->spill(data);
+  trade_lines = {};  // every indexed trade is on disk now, later breaks of them go to spilled_breaks
+  Memory::messages.release(buffered_bytes);
+  buffered_bytes = 0;
+}
+
+void TopsReader::dump_files() {
+  if (verifier) {
+    verifier->finish();
+  }
+  if (shards) {
+    shards->finish();
+    return;
+  }
+
+  if (conflator) {
+    conflator->finish(quote_lines);
+    store_quotes();
+  }
+
+  OutputWriter writer(out_dir, options.output);
+
+  if (runs) {
+    // spill what is still in memory too, so every line goes through the merge
+    runs->spill(data);
+    std::sort(spilled_breaks.begin(), spilled_breaks.end());
+    runs->merge(spilled_breaks, writer);
+    runs.reset();
+  } else {
+    for (auto const& [symbol, store] : data) {
+      auto file_name = symbol + ".csv";
+      std::string buffer;
+
+      for (auto& value : store.lines) {
+        if (value.empty()) {
+          continue;  // broken trade
+        }
+        buffer += value;
+        buffer += '\n';
+        if (buffer.size() >= DUMP_BUFFER_SIZE) {
+          writer.append(file_name, buffer);
+          buffer.clear();
+        }
+      }
+      writer.append(file_name, buffer);
+    }
+  }
+
+  if (summary) {
+    summary->write(writer);
+  }
+  writer.finish();
+  writer.report();
+
+  data.clear();
+  Memory::messages.release(buffered_bytes);
+  buffered_bytes = 0;
+}
@@ -20,6 +20,8 @@ std::unique_ptr<TopsMessage> TopsMessage::read_message(pcap_cit_t it) {
       return QuoteUpdateMessage::from_raw_message(it);
     case TradeReportType:
       return TradeReportMessage::from_raw_message(it);
+    case TradeBreakType:
+      return TradeBreakMessage::from_raw_message(it);
     default:
       return nullptr;
   }
@@ -51,6 +53,17 @@ std::unique_ptr<AuctionInformationMessage> AuctionInformationMessage::from_raw_m
 TradeBreakMessage::TradeBreakMessage(uint8_t f, int64_t t, std::array<char, 8> s, uint32_t si, int64_t p, int64_t ti)
     : TopsMessage(TradeBreakType), flags(f), timestamp(t), symbol(s), size(si), price(p), trade_id(ti) {}
 
+std::unique_ptr<TradeBreakMessage> TradeBreakMessage::from_raw_message(pcap_cit_t it) {
+  auto flags = read_bytes<Byte>(it);
+  auto timestamp = read_bytes<Timestamp>(it);
+  auto symbol = read_bytes<Symbol>(it);
+  auto size = read_bytes<Integer>(it);
+  auto price = read_bytes<Price>(it);
+  auto trade_id = read_bytes<Long>(it);
+
+  return std::make_unique<TradeBreakMessage>(flags, timestamp, symbol, size, price, trade_id);
+}
+
 SecurityDirectoryMessage::SecurityDirectoryMessage(uint8_t f, int64_t t, std::array<char, 8> s, uint32_t rls,
                                                    int64_t app, uint8_t l)
     : TopsMessage(SecurityDirectoryType),